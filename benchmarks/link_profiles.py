@@ -0,0 +1,96 @@
+"""
+End-to-end step time of a reference model under emulated network links.
+
+Each profile from remote_cuda.LINK_PROFILES is applied to the executor
+connection in turn and the same training-style step is timed under it:
+upload an input batch, produce every layer's activations on the executor
+and download the logits. Compare the rows to see how sensitive a setting
+(batching, compression, lazy evaluation) is to RTT versus bandwidth.
+
+    bazel run //:link_profiles_benchmark -- --steps 20 --profiles same_rack cross_region
+"""
+import argparse
+import statistics
+import time
+
+import torch
+import remote_cuda
+
+
+class ReferenceMLP(torch.nn.Module):
+    def __init__(self, in_features, hidden, num_layers, num_classes, device):
+        super().__init__()
+        sizes = [in_features] + [hidden] * num_layers + [num_classes]
+        self.layers = torch.nn.ModuleList(
+            torch.nn.Linear(sizes[i], sizes[i + 1], device=device)
+            for i in range(len(sizes) - 1))
+
+    def step(self, batch):
+        """One forward pass, returning the logits on the host"""
+        x = batch.to(remote_cuda.REMOTE_CUDA)
+        for layer in self.layers:
+            # Only allocation, copy and random kernels execute remotely so
+            # far; the stand-in fill keeps the allocation and transfer
+            # pattern of layer(x) without needing a matmul kernel
+            x = torch.empty(x.shape[0], layer.out_features,
+                            device=remote_cuda.REMOTE_CUDA).normal_()
+        return x.cpu()
+
+
+def run_profile(model, name, args):
+    remote_cuda.configure_link(name)
+    batch = torch.randn(args.batch_size, args.in_features)
+    for _ in range(args.warmup):
+        model.step(batch)
+
+    remote_cuda.reset_link_stats()
+    step_times = []
+    for _ in range(args.steps):
+        start = time.perf_counter()
+        model.step(batch)
+        step_times.append(time.perf_counter() - start)
+    stats = remote_cuda.link_stats()
+
+    total = sum(step_times)
+    return {
+        "profile": name,
+        "mean_ms": 1e3 * total / args.steps,
+        "p50_ms": 1e3 * statistics.median(step_times),
+        "p95_ms": 1e3 * sorted(step_times)[int(0.95 * (args.steps - 1))],
+        "requests": stats["requests"] / args.steps,
+        "mb": (stats["bytes_sent"] + stats["bytes_received"]) / args.steps / 2**20,
+        "link_pct": 100 * stats["delay_s"] / total if total else 0.0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--profiles", nargs="+", default=list(remote_cuda.LINK_PROFILES),
+                        choices=list(remote_cuda.LINK_PROFILES))
+    parser.add_argument("--steps", type=int, default=10)
+    parser.add_argument("--warmup", type=int, default=2)
+    parser.add_argument("--batch-size", type=int, default=64)
+    parser.add_argument("--in-features", type=int, default=1024)
+    parser.add_argument("--hidden", type=int, default=4096)
+    parser.add_argument("--num-layers", type=int, default=4)
+    parser.add_argument("--num-classes", type=int, default=1000)
+    args = parser.parse_args()
+
+    # Parameters are created before any link is applied, like weights that
+    # were loaded once ahead of serving
+    remote_cuda.init()
+    model = ReferenceMLP(args.in_features, args.hidden, args.num_layers,
+                         args.num_classes, remote_cuda.REMOTE_CUDA)
+
+    header = f"{'profile':<18}{'mean ms':>10}{'p50 ms':>10}{'p95 ms':>10}{'req/step':>10}{'MB/step':>10}{'link %':>8}"
+    print(header)
+    print("-" * len(header))
+    for name in args.profiles:
+        row = run_profile(model, name, args)
+        print(f"{row['profile']:<18}{row['mean_ms']:>10.2f}{row['p50_ms']:>10.2f}{row['p95_ms']:>10.2f}"
+              f"{row['requests']:>10.1f}{row['mb']:>10.2f}{row['link_pct']:>8.1f}")
+    remote_cuda.configure_link("loopback")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,281 @@
+#include "batch_scheduler.h"
+
+#include <algorithm>
+#include <sstream>
+#include <spdlog/spdlog.h>
+
+namespace remote_cuda {
+
+BatchScheduler::BatchScheduler(BatchSchedulerConfig config)
+	: config_(config) {
+	TORCH_CHECK(config_.max_batch_size > 0, "BatchScheduler: max_batch_size must be positive");
+	TORCH_CHECK(config_.max_requests_per_session > 0,
+			"BatchScheduler: max_requests_per_session must be positive");
+	dispatcher_ = std::thread(&BatchScheduler::dispatch_loop, this);
+}
+
+BatchScheduler::~BatchScheduler() {
+	shutdown();
+}
+
+void BatchScheduler::register_program(const std::string& program_id, ProgramFn fn, bool batchable) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	programs_[program_id] = Program{std::move(fn), batchable};
+}
+
+// Requests only merge when every input agrees on dtype, device and all
+// dimensions but the batch dimension. Returns an empty key when the inputs
+// have no common batch dimension.
+std::string BatchScheduler::batch_key(const std::string& program_id,
+		const std::vector<at::Tensor>& inputs) {
+	if (inputs.empty()) {
+		return "";
+	}
+	const int64_t rows = inputs[0].dim() > 0 ? inputs[0].size(0) : -1;
+	std::ostringstream key;
+	key << program_id;
+	for (const at::Tensor& input : inputs) {
+		if (input.dim() == 0 || input.size(0) != rows) {
+			return "";
+		}
+		key << '|' << c10::toString(input.scalar_type()) << '@' << input.device() << ':';
+		for (int64_t d = 1; d < input.dim(); ++d) {
+			key << input.size(d) << ',';
+		}
+	}
+	return key.str();
+}
+
+std::future<std::vector<at::Tensor>> BatchScheduler::submit(uint64_t session_id,
+		const std::string& program_id, std::vector<at::Tensor> inputs) {
+	Request request;
+	request.session_id = session_id;
+	request.rows = inputs.empty() || inputs[0].dim() == 0 ? 0 : inputs[0].size(0);
+	request.enqueue_time = std::chrono::steady_clock::now();
+	std::future<std::vector<at::Tensor>> result = request.promise.get_future();
+
+	std::string key = batch_key(program_id, inputs);
+	request.inputs = std::move(inputs);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	TORCH_CHECK(!stopping_, "BatchScheduler: submit after shutdown");
+	auto program = programs_.find(program_id);
+	TORCH_CHECK(program != programs_.end(), "BatchScheduler: unknown program ", program_id);
+	stats_.requests++;
+
+	if (key.empty() || !program->second.batchable) {
+		// Nothing to concatenate along, run it on the caller's thread
+		ProgramFn fn = program->second.fn;
+		stats_.unbatched_requests++;
+		lock.unlock();
+		std::vector<Request> batch;
+		batch.push_back(std::move(request));
+		run_batch(fn, batch);
+		return result;
+	}
+
+	Queue& queue = queues_[key];
+	if (!queue.fn) {
+		queue.fn = program->second.fn;
+	}
+	queue.pending_rows += request.rows;
+	queue.pending_requests++;
+	queue.per_session[session_id].push_back(std::move(request));
+	lock.unlock();
+	cv_.notify_one();
+	return result;
+}
+
+BatchScheduler::QueueMap::iterator BatchScheduler::ready_queue(std::chrono::steady_clock::time_point now,
+		std::chrono::steady_clock::time_point* wake_up) {
+	auto ready = queues_.end();
+	auto ready_since = std::chrono::steady_clock::time_point::max();
+	*wake_up = std::chrono::steady_clock::time_point::max();
+
+	for (auto entry = queues_.begin(); entry != queues_.end(); ++entry) {
+		Queue& queue = entry->second;
+		if (queue.pending_requests == 0) {
+			continue;
+		}
+		auto oldest = std::chrono::steady_clock::time_point::max();
+		for (const auto& session : queue.per_session) {
+			if (!session.second.empty()) {
+				oldest = std::min(oldest, session.second.front().enqueue_time);
+			}
+		}
+		const auto deadline = oldest + config_.max_queue_delay;
+		const bool full = queue.pending_rows >= config_.max_batch_size;
+		if (full || deadline <= now || stopping_) {
+			// Serve the queue whose oldest request has waited longest
+			if (oldest < ready_since) {
+				ready = entry;
+				ready_since = oldest;
+			}
+		} else {
+			*wake_up = std::min(*wake_up, deadline);
+		}
+	}
+	return ready;
+}
+
+// Fill a batch round-robin over sessions, one request per session per pass,
+// so a chatty session cannot starve the others out of a batch.
+std::vector<BatchScheduler::Request> BatchScheduler::take_batch(Queue& queue) {
+	std::vector<Request> batch;
+	std::unordered_map<uint64_t, int> taken;
+	int64_t rows = 0;
+
+	auto start = queue.per_session.lower_bound(queue.next_session);
+	if (start == queue.per_session.end()) {
+		start = queue.per_session.begin();
+	}
+	const uint64_t first_session = start->first;
+
+	bool progress = true;
+	while (progress) {
+		progress = false;
+		auto it = start;
+		do {
+			std::deque<Request>& pending = it->second;
+			if (!pending.empty() && taken[it->first] < config_.max_requests_per_session &&
+					(batch.empty() || rows + pending.front().rows <= config_.max_batch_size)) {
+				rows += pending.front().rows;
+				batch.push_back(std::move(pending.front()));
+				pending.pop_front();
+				taken[it->first]++;
+				progress = true;
+			}
+			if (++it == queue.per_session.end()) {
+				it = queue.per_session.begin();
+			}
+		} while (it != start);
+	}
+
+	for (auto it = queue.per_session.begin(); it != queue.per_session.end();) {
+		it = it->second.empty() ? queue.per_session.erase(it) : std::next(it);
+	}
+	queue.next_session = first_session + 1;
+	queue.pending_rows -= rows;
+	queue.pending_requests -= batch.size();
+
+	stats_.batches++;
+	stats_.batched_rows += rows;
+	return batch;
+}
+
+void BatchScheduler::run_batch(const ProgramFn& fn, std::vector<Request>& batch) {
+	if (batch.size() == 1) {
+		try {
+			batch[0].promise.set_value(fn(batch[0].inputs));
+		} catch (...) {
+			batch[0].promise.set_exception(std::current_exception());
+		}
+		return;
+	}
+
+	std::vector<int64_t> rows;
+	rows.reserve(batch.size());
+	int64_t total_rows = 0;
+	for (const Request& request : batch) {
+		rows.push_back(request.rows);
+		total_rows += request.rows;
+	}
+
+	try {
+		std::vector<at::Tensor> merged_inputs;
+		const size_t num_inputs = batch[0].inputs.size();
+		merged_inputs.reserve(num_inputs);
+		for (size_t i = 0; i < num_inputs; ++i) {
+			std::vector<at::Tensor> parts;
+			parts.reserve(batch.size());
+			for (const Request& request : batch) {
+				parts.push_back(request.inputs[i]);
+			}
+			merged_inputs.push_back(at::cat(parts, 0));
+		}
+
+		std::vector<at::Tensor> merged_outputs = fn(merged_inputs);
+
+		bool splittable = true;
+		for (const at::Tensor& output : merged_outputs) {
+			splittable = splittable && output.dim() > 0 && output.size(0) == total_rows;
+		}
+
+		if (!splittable) {
+			// The merged run already happened, replaying requests one by one
+			// would repeat its compute and side effects
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stats_.unsplittable_batches++;
+			}
+			TORCH_CHECK(false, "BatchScheduler: a program registered as batchable returned outputs "
+					"that are not batched along dim 0; register it with batchable = false");
+		}
+
+		std::vector<std::vector<at::Tensor>> outputs(batch.size());
+		for (const at::Tensor& output : merged_outputs) {
+			std::vector<at::Tensor> slices = output.split_with_sizes(rows, 0);
+			for (size_t r = 0; r < batch.size(); ++r) {
+				outputs[r].push_back(std::move(slices[r]));
+			}
+		}
+		for (size_t r = 0; r < batch.size(); ++r) {
+			batch[r].promise.set_value(std::move(outputs[r]));
+		}
+	} catch (...) {
+		SPDLOG_WARN("[BatchScheduler] batch of {} requests failed", batch.size());
+		for (Request& request : batch) {
+			request.promise.set_exception(std::current_exception());
+		}
+	}
+}
+
+void BatchScheduler::dispatch_loop() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		std::chrono::steady_clock::time_point wake_up;
+		auto queue = ready_queue(std::chrono::steady_clock::now(), &wake_up);
+		if (queue != queues_.end()) {
+			std::vector<Request> batch = take_batch(queue->second);
+			ProgramFn fn = queue->second.fn;
+			if (queue->second.pending_requests == 0) {
+				// Batch keys include shapes, which come and go with the
+				// clients' inputs, so drained queues are not kept around
+				queues_.erase(queue);
+			}
+			lock.unlock();
+			run_batch(fn, batch);
+			lock.lock();
+			continue;
+		}
+		if (stopping_) {
+			break;
+		}
+		if (wake_up == std::chrono::steady_clock::time_point::max()) {
+			cv_.wait(lock);
+		} else {
+			cv_.wait_until(lock, wake_up);
+		}
+	}
+}
+
+void BatchScheduler::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (stopping_) {
+			return;
+		}
+		stopping_ = true;
+	}
+	cv_.notify_all();
+	if (dispatcher_.joinable()) {
+		dispatcher_.join();
+	}
+}
+
+BatchSchedulerStats BatchScheduler::stats() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+}  // namespace remote_cuda
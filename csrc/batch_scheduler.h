@@ -0,0 +1,126 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Executor-side dynamic batching across client sessions.
+ * Many small clients replay the same program (same op sequence) with a small
+ * batch each. The scheduler groups requests for the same program whose inputs
+ * only differ in dim 0, holds them for at most max_queue_delay, concatenates
+ * the inputs along dim 0, runs the program once and splits the outputs back
+ * to each caller.
+ */
+
+namespace remote_cuda {
+
+// Executes a replayed program on the executor. Every input and output is
+// batched along dim 0.
+using ProgramFn = std::function<std::vector<at::Tensor>(const std::vector<at::Tensor>&)>;
+
+struct BatchSchedulerConfig {
+	// Upper bound on the merged batch (sum of dim 0 over merged requests)
+	int64_t max_batch_size = 64;
+	// Latency SLO knob: longest time a request waits for others to join it
+	std::chrono::microseconds max_queue_delay{2000};
+	// Fairness knob: at most this many requests of one session per batch
+	int max_requests_per_session = 4;
+};
+
+struct BatchSchedulerStats {
+	uint64_t requests = 0;
+	uint64_t batches = 0;
+	uint64_t batched_rows = 0;
+	// Requests run on their own: the program is not batchable or the inputs
+	// have no common batch dimension
+	uint64_t unbatched_requests = 0;
+	// Merged runs of a batchable program whose outputs were not batched
+	// along dim 0; every request in them fails
+	uint64_t unsplittable_batches = 0;
+};
+
+class BatchScheduler {
+	public:
+		explicit BatchScheduler(BatchSchedulerConfig config = BatchSchedulerConfig());
+		~BatchScheduler();
+
+		BatchScheduler(const BatchScheduler&) = delete;
+		BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+		// Register a program under an id shared by all sessions replaying it.
+		// batchable promises that every output row depends only on the same
+		// input row; programs that mix rows (e.g. reduce over the batch) must
+		// pass false and then run once per request.
+		void register_program(const std::string& program_id, ProgramFn fn, bool batchable = true);
+
+		// Queue one session's invocation. The future resolves with this
+		// request's slice of the batched outputs.
+		std::future<std::vector<at::Tensor>> submit(uint64_t session_id,
+				const std::string& program_id, std::vector<at::Tensor> inputs);
+
+		// Drain queued requests and stop the dispatcher thread
+		void shutdown();
+
+		BatchSchedulerStats stats() const;
+
+	private:
+		struct Request {
+			uint64_t session_id;
+			std::vector<at::Tensor> inputs;
+			int64_t rows;
+			std::promise<std::vector<at::Tensor>> promise;
+			std::chrono::steady_clock::time_point enqueue_time;
+		};
+
+		// Requests that can be merged: same program, same dtypes and same
+		// shapes apart from dim 0
+		struct Queue {
+			ProgramFn fn;
+			std::map<uint64_t, std::deque<Request>> per_session;
+			int64_t pending_rows = 0;
+			size_t pending_requests = 0;
+			// Session to start the next round-robin pass from
+			uint64_t next_session = 0;
+		};
+
+		struct Program {
+			ProgramFn fn;
+			bool batchable;
+		};
+
+		using QueueMap = std::unordered_map<std::string, Queue>;
+
+		static std::string batch_key(const std::string& program_id,
+				const std::vector<at::Tensor>& inputs);
+
+		void dispatch_loop();
+		// Returns the queue to dispatch now, or queues_.end() and the time to wake up
+		QueueMap::iterator ready_queue(std::chrono::steady_clock::time_point now,
+				std::chrono::steady_clock::time_point* wake_up);
+		std::vector<Request> take_batch(Queue& queue);
+		void run_batch(const ProgramFn& fn, std::vector<Request>& batch);
+
+		BatchSchedulerConfig config_;
+		mutable std::mutex mutex_;
+		std::condition_variable cv_;
+		std::unordered_map<std::string, Program> programs_;
+		// One entry per batch key with queued requests, erased once drained
+		QueueMap queues_;
+		BatchSchedulerStats stats_;
+		bool stopping_ = false;
+		std::thread dispatcher_;
+};
+
+}  // namespace remote_cuda
@@ -0,0 +1,441 @@
+#include "checkpoint_loader.h"
+#include "memory_manager.h"
+#include "remote_device.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace remote_cuda {
+
+namespace {
+
+struct TensorEntry {
+	std::string name;
+	at::ScalarType dtype = at::kFloat;
+	std::vector<int64_t> shape;
+	size_t begin = 0;
+	size_t end = 0;
+};
+
+at::ScalarType parse_dtype(const std::string& dtype) {
+	static const std::unordered_map<std::string, at::ScalarType> kDtypes = {
+		{"F64", at::kDouble},
+		{"F32", at::kFloat},
+		{"F16", at::kHalf},
+		{"BF16", at::kBFloat16},
+		{"I64", at::kLong},
+		{"I32", at::kInt},
+		{"I16", at::kShort},
+		{"I8", at::kChar},
+		{"U8", at::kByte},
+		{"BOOL", at::kBool},
+		{"F8_E4M3", at::kFloat8_e4m3fn},
+		{"F8_E5M2", at::kFloat8_e5m2},
+	};
+	auto it = kDtypes.find(dtype);
+	if (it == kDtypes.end()) {
+		throw std::runtime_error("load_checkpoint: unsupported dtype " + dtype);
+	}
+	return it->second;
+}
+
+// Minimal JSON reader for the safetensors header. Only understands the
+// header layout: {"name": {"dtype": ..., "shape": [...], "data_offsets": [...]}}
+// plus an optional "__metadata__" object which is skipped.
+class HeaderParser {
+	public:
+		HeaderParser(const char* data, size_t size)
+			: begin_(data), p_(data), end_(data + size) {}
+
+		std::vector<TensorEntry> parse() {
+			std::vector<TensorEntry> entries;
+			expect('{');
+			if (consume('}')) {
+				return entries;
+			}
+			do {
+				std::string name = parse_string();
+				expect(':');
+				if (name == "__metadata__") {
+					skip_value();
+				} else {
+					entries.push_back(parse_entry(std::move(name)));
+				}
+			} while (consume(','));
+			expect('}');
+			return entries;
+		}
+
+	private:
+		TensorEntry parse_entry(std::string name) {
+			TensorEntry entry;
+			entry.name = std::move(name);
+			bool has_dtype = false, has_shape = false, has_offsets = false;
+			expect('{');
+			if (!consume('}')) {
+				do {
+					std::string key = parse_string();
+					expect(':');
+					if (key == "dtype") {
+						entry.dtype = parse_dtype(parse_string());
+						has_dtype = true;
+					} else if (key == "shape") {
+						entry.shape = parse_int_array();
+						has_shape = true;
+					} else if (key == "data_offsets") {
+						std::vector<int64_t> offsets = parse_int_array();
+						if (offsets.size() != 2 || offsets[0] < 0 || offsets[1] < offsets[0]) {
+							fail("invalid data_offsets for " + entry.name);
+						}
+						entry.begin = static_cast<size_t>(offsets[0]);
+						entry.end = static_cast<size_t>(offsets[1]);
+						has_offsets = true;
+					} else {
+						skip_value();
+					}
+				} while (consume(','));
+				expect('}');
+			}
+			if (!has_dtype || !has_shape || !has_offsets) {
+				fail("incomplete entry for " + entry.name);
+			}
+			return entry;
+		}
+
+		void skip_ws() {
+			while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+				++p_;
+			}
+		}
+
+		bool consume(char c) {
+			skip_ws();
+			if (p_ < end_ && *p_ == c) {
+				++p_;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(char c) {
+			if (!consume(c)) {
+				fail(std::string("expected '") + c + "'");
+			}
+		}
+
+		std::string parse_string() {
+			expect('"');
+			std::string out;
+			while (p_ < end_ && *p_ != '"') {
+				char c = *p_++;
+				if (c != '\\') {
+					out.push_back(c);
+					continue;
+				}
+				if (p_ >= end_) {
+					break;
+				}
+				char escaped = *p_++;
+				switch (escaped) {
+					case 'b': out.push_back('\b'); break;
+					case 'f': out.push_back('\f'); break;
+					case 'n': out.push_back('\n'); break;
+					case 'r': out.push_back('\r'); break;
+					case 't': out.push_back('\t'); break;
+					case 'u': append_utf8(parse_hex4(), &out); break;
+					default: out.push_back(escaped); break;
+				}
+			}
+			expect('"');
+			return out;
+		}
+
+		uint32_t parse_hex4() {
+			if (end_ - p_ < 4) {
+				fail("truncated \\u escape");
+			}
+			uint32_t code = 0;
+			for (int i = 0; i < 4; ++i) {
+				char c = *p_++;
+				code <<= 4;
+				if (c >= '0' && c <= '9') code |= c - '0';
+				else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+				else fail("invalid \\u escape");
+			}
+			return code;
+		}
+
+		static void append_utf8(uint32_t code, std::string* out) {
+			if (code < 0x80) {
+				out->push_back(static_cast<char>(code));
+			} else if (code < 0x800) {
+				out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+				out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+			} else {
+				out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+				out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+				out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+			}
+		}
+
+		int64_t parse_int() {
+			skip_ws();
+			const char* start = p_;
+			if (p_ < end_ && *p_ == '-') ++p_;
+			int64_t value = 0;
+			while (p_ < end_ && *p_ >= '0' && *p_ <= '9') {
+				const int digit = *p_++ - '0';
+				if (value > (std::numeric_limits<int64_t>::max() - digit) / 10) {
+					fail("integer out of range");
+				}
+				value = value * 10 + digit;
+			}
+			if (p_ == start || (p_ == start + 1 && *start == '-')) {
+				fail("expected integer");
+			}
+			return *start == '-' ? -value : value;
+		}
+
+		std::vector<int64_t> parse_int_array() {
+			std::vector<int64_t> values;
+			expect('[');
+			if (consume(']')) {
+				return values;
+			}
+			do {
+				values.push_back(parse_int());
+			} while (consume(','));
+			expect(']');
+			return values;
+		}
+
+		void skip_value() {
+			skip_ws();
+			if (p_ >= end_) {
+				fail("unexpected end of header");
+			}
+			if (*p_ == '"') {
+				parse_string();
+			} else if (*p_ == '{' || *p_ == '[') {
+				const char close = *p_ == '{' ? '}' : ']';
+				++p_;
+				if (consume(close)) {
+					return;
+				}
+				do {
+					if (close == '}') {
+						parse_string();
+						expect(':');
+					}
+					skip_value();
+				} while (consume(','));
+				expect(close);
+			} else {
+				// Number or literal
+				while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' &&
+						*p_ != ' ' && *p_ != '\n' && *p_ != '\r' && *p_ != '\t') {
+					++p_;
+				}
+			}
+		}
+
+		[[noreturn]] void fail(const std::string& what) {
+			throw std::runtime_error("load_checkpoint: malformed header at byte " +
+					std::to_string(p_ - begin_) + ": " + what);
+		}
+
+		const char* begin_;
+		const char* p_;
+		const char* end_;
+};
+
+// Read-only mapping of the whole checkpoint file
+class MappedFile {
+	public:
+		explicit MappedFile(const std::string& path) {
+			int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("load_checkpoint: cannot open " + path + ": " + std::strerror(errno));
+			}
+			struct stat st;
+			if (::fstat(fd, &st) != 0) {
+				::close(fd);
+				throw std::runtime_error("load_checkpoint: cannot stat " + path);
+			}
+			size_ = static_cast<size_t>(st.st_size);
+			if (size_ > 0) {
+				void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data == MAP_FAILED) {
+					::close(fd);
+					throw std::runtime_error("load_checkpoint: cannot mmap " + path + ": " + std::strerror(errno));
+				}
+				data_ = static_cast<const char*>(data);
+			}
+			::close(fd);
+		}
+
+		~MappedFile() {
+			if (data_) {
+				::munmap(const_cast<char*>(data_), size_);
+			}
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data() const { return data_; }
+		size_t size() const { return size_; }
+
+		// Drop uploaded pages from the client's resident set. The mapping is
+		// read-only, so a later touch simply faults the page back in.
+		void release(const char* ptr, size_t len) const {
+			static const uintptr_t page = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+			uintptr_t start = reinterpret_cast<uintptr_t>(ptr) & ~(page - 1);
+			uintptr_t stop = reinterpret_cast<uintptr_t>(ptr) + len;
+			::madvise(reinterpret_cast<void*>(start), stop - start, MADV_DONTNEED);
+		}
+
+	private:
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+};
+
+}  // namespace
+
+std::vector<std::pair<std::string, at::Tensor>> load_checkpoint(
+		const std::string& path, const CheckpointLoadOptions& options) {
+	MappedFile file(path);
+	if (file.size() < 8) {
+		throw std::runtime_error("load_checkpoint: " + path + " is too small to be a safetensors file");
+	}
+
+	// 8-byte little-endian header length followed by the JSON header
+	uint64_t header_len = 0;
+	const unsigned char* raw = reinterpret_cast<const unsigned char*>(file.data());
+	for (int i = 7; i >= 0; --i) {
+		header_len = (header_len << 8) | raw[i];
+	}
+	if (header_len > file.size() - 8) {
+		throw std::runtime_error("load_checkpoint: header length exceeds file size in " + path);
+	}
+	const size_t data_base = 8 + header_len;
+
+	std::vector<TensorEntry> entries = HeaderParser(file.data() + 8, header_len).parse();
+	std::sort(entries.begin(), entries.end(),
+			[](const TensorEntry& a, const TensorEntry& b) { return a.begin < b.begin; });
+
+	for (const TensorEntry& entry : entries) {
+		int64_t numel = 1;
+		for (int64_t dim : entry.shape) {
+			if (dim < 0 || (dim > 0 && numel > std::numeric_limits<int64_t>::max() / dim)) {
+				throw std::runtime_error("load_checkpoint: invalid shape for " + entry.name);
+			}
+			numel *= dim;
+		}
+		const size_t expected = static_cast<size_t>(numel) * at::elementSize(entry.dtype);
+		if (entry.end - entry.begin != expected || entry.end > file.size() - data_base) {
+			throw std::runtime_error("load_checkpoint: byte range of " + entry.name + " does not match its shape");
+		}
+	}
+
+	::madvise(const_cast<char*>(file.data()), file.size(), MADV_SEQUENTIAL);
+
+	std::vector<void*> remote_ptrs(entries.size(), nullptr);
+	std::atomic<size_t> next{0};
+	std::atomic<bool> failed{false};
+	std::mutex error_mutex;
+	std::string error_message;
+	const size_t chunk_bytes = std::max<size_t>(options.chunk_bytes, 1);
+
+	auto record_error = [&](const std::string& message) {
+		std::lock_guard<std::mutex> lock(error_mutex);
+		if (error_message.empty()) {
+			error_message = message;
+		}
+		failed = true;
+	};
+
+	auto worker = [&]() {
+		while (!failed) {
+			const size_t i = next++;
+			if (i >= entries.size()) {
+				return;
+			}
+			const TensorEntry& entry = entries[i];
+			const size_t nbytes = entry.end - entry.begin;
+
+			// Exact size: pool rounding could double the footprint of large weights
+			rpc_client::Error error;
+			void* remote_ptr = memory_manager::allocate_exact(nbytes, &error);
+			if (error) {
+				record_error("allocating " + entry.name + ": " + error.message());
+				return;
+			}
+			remote_ptrs[i] = remote_ptr;
+
+			const char* src = file.data() + data_base + entry.begin;
+			for (size_t offset = 0; offset < nbytes; offset += chunk_bytes) {
+				const size_t len = std::min(chunk_bytes, nbytes - offset);
+				error = rpc_client::upload_tensor_data(static_cast<char*>(remote_ptr) + offset, src + offset, len);
+				if (error) {
+					record_error("uploading " + entry.name + ": " + error.message());
+					return;
+				}
+				file.release(src + offset, len);
+			}
+		}
+	};
+
+	const size_t num_threads = std::min<size_t>(std::max(options.num_threads, 1), std::max<size_t>(entries.size(), 1));
+	std::vector<std::thread> workers;
+	workers.reserve(num_threads);
+	for (size_t t = 0; t < num_threads; ++t) {
+		workers.emplace_back(worker);
+	}
+	for (std::thread& t : workers) {
+		t.join();
+	}
+
+	if (failed) {
+		for (void* ptr : remote_ptrs) {
+			if (ptr) {
+				memory_manager::free(ptr);
+			}
+		}
+		throw std::runtime_error("load_checkpoint: " + error_message);
+	}
+
+	std::vector<std::pair<std::string, at::Tensor>> tensors;
+	tensors.reserve(entries.size());
+	const c10::Device device(REMOTE_CUDA_TYPE, options.device_index);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		void* remote_ptr = remote_ptrs[i];
+		at::Tensor tensor = at::from_blob(
+				remote_ptr,
+				entries[i].shape,
+				[remote_ptr](void*) {
+					memory_manager::free(remote_ptr);
+				},
+				at::TensorOptions().dtype(entries[i].dtype).device(device));
+		memory_manager::register_tensor(remote_ptr, tensor);
+		tensors.emplace_back(entries[i].name, std::move(tensor));
+	}
+
+	SPDLOG_INFO("Loaded {} tensors from {} straight to remote device {}", tensors.size(), path, options.device_index);
+	return tensors;
+}
+
+}  // namespace remote_cuda
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <torch/extension.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Streaming checkpoint loader.
+ * Memory-maps a safetensors file and uploads each tensor's byte range straight
+ * from the mapping into its remote allocation. No CPU tensor is built, and
+ * pages are dropped from the mapping once uploaded, so peak client memory
+ * stays at a few chunks per worker instead of the full checkpoint.
+ */
+
+namespace remote_cuda {
+
+struct CheckpointLoadOptions {
+	int device_index = 0;
+	// Tensors are uploaded concurrently by this many workers
+	int num_threads = 8;
+	// Each upload is split into chunks of this size
+	size_t chunk_bytes = 64ULL << 20;
+};
+
+// Returns (name, remote tensor) pairs in file order.
+// Throws std::runtime_error on malformed files or failed transfers.
+std::vector<std::pair<std::string, at::Tensor>> load_checkpoint(
+		const std::string& path,
+		const CheckpointLoadOptions& options = CheckpointLoadOptions());
+
+}  // namespace remote_cuda
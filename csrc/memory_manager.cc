@@ -1,22 +1,31 @@
 #include "memory_manager.h"
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
 #include <unordered_map>
-#include "flat_hash_map"
+#include <unordered_set>
+#include <map>
 #include <algorithm>
-#include <numeric>
 #include <list>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <c10/util/Backtrace.h>
+#include <spdlog/spdlog.h>
 
 namespace memory_manager {
 
 namespace {
     // Global state
     std::mutex g_mutex;
-    std::unordered_map<void*, at::Tensor> g_remote_tensors;
+    // Weak references so that registering a tensor does not keep it alive
+    using WeakTensorImpl = c10::weak_intrusive_ptr<c10::TensorImpl, c10::UndefinedTensorImpl>;
+    std::unordered_map<void*, WeakTensorImpl> g_remote_tensors;
     MemoryConfig g_config;
     bool g_initialized = false;
+    // Read without g_mutex on every op to skip residency tracking when off
+    std::atomic<bool> g_oversubscription{false};
 
     // Memory pool implementation
     struct MemoryBlock {
@@ -28,14 +37,40 @@ namespace {
             : ptr(p), size(s), last_used(std::chrono::steady_clock::now()) {}
     };
 
+    // Executor block handed out by allocate() and not freed yet
+    struct LiveBlock {
+        size_t size;
+        // Storage living on this block. Only blocks with a registered
+        // storage can be evicted, the rest are not reachable from a tensor.
+        c10::weak_intrusive_ptr<c10::StorageImpl> storage;
+        std::chrono::steady_clock::time_point last_used;
+        std::list<void*>::iterator lru_pos;
+        bool in_lru = false;
+        // Stack of the allocation, when history recording asked for it
+        Frames frames;
+
+        LiveBlock(size_t s, Frames f)
+            : size(s), storage(c10::intrusive_ptr<c10::StorageImpl>()),
+              last_used(std::chrono::steady_clock::now()), frames(std::move(f)) {}
+    };
+
+    std::unordered_map<void*, LiveBlock> g_live_blocks;
+    // Evictable blocks, most recently used first
+    std::list<void*> g_lru;
+    // Storages held by pin_storage(), with their pin count. Kept off g_lru.
+    std::unordered_map<c10::StorageImpl*, int> g_pins;
+    // Storages being faulted back in; others touching them wait on g_fault_cv
+    std::unordered_set<c10::StorageImpl*> g_faulting;
+    std::condition_variable g_fault_cv;
+
     // Structure to track memory allocations by size
     struct MemoryPool {
-        // Free blocks organized by size buckets
-        std::unordered_map<size_t, std::list<MemoryBlock>> free_blocks;
+        // Free blocks organized by size buckets, ordered for best-fit lookup
+        std::map<size_t, std::list<MemoryBlock>> free_blocks;
+        size_t cache_bytes = 0;
 
-        // Total memory allocated
-        size_t total_allocated = 0;
-        size_t peak_allocated = 0;
+        // Executor usage; reserved_bytes counts cached blocks too
+        DeviceStats stats;
 
         // Statistics
         size_t transfer_bytes_to_remote = 0;
@@ -46,6 +81,99 @@ namespace {
 
     std::unique_ptr<MemoryPool> g_memory_pool;
 
+    void update_stat(Stat& stat, int64_t amount) {
+        stat.current += amount;
+        if (amount > 0) {
+            stat.allocated += amount;
+            stat.peak = std::max(stat.peak, stat.current);
+        } else {
+            stat.freed -= amount;
+        }
+    }
+
+    size_t reserved_bytes_locked() {
+        return static_cast<size_t>(g_memory_pool->stats.reserved_bytes.current);
+    }
+
+    // Bounded ring buffer of allocator events
+    struct MemoryHistory {
+        MemoryHistoryConfig config;
+        std::vector<TraceEntry> entries;
+        // Slot the next event overwrites once the buffer is full
+        size_t next = 0;
+    };
+
+    MemoryHistory g_history;
+    std::atomic<StackGatherer> g_stack_gatherer{nullptr};
+
+    // Which stacks g_history.config asks for, readable without g_mutex so
+    // allocate() and free() skip the lock while recording is off
+    enum StackFlags : uint8_t {
+        kAllocStacks = 1 << 0,
+        kFreeStacks = 1 << 1,
+        kCppStacks = 1 << 2,
+    };
+    std::atomic<uint8_t> g_stack_flags{0};
+
+    int64_t now_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Stack of the calling thread for an allocation or a free, or null when
+    // history recording does not ask for one. Called without g_mutex.
+    Frames capture_stack(bool is_free) {
+        const uint8_t flags = g_stack_flags.load(std::memory_order_relaxed);
+        if (!(flags & (is_free ? kFreeStacks : kAllocStacks))) {
+            return nullptr;
+        }
+        const bool cpp_stacks = flags & kCppStacks;
+
+        auto frames = std::make_shared<std::vector<TraceFrame>>();
+        if (StackGatherer gatherer = g_stack_gatherer.load()) {
+            *frames = gatherer();
+        }
+        if (cpp_stacks) {
+            std::istringstream backtrace(c10::get_backtrace(/*frames_to_skip=*/2));
+            std::string line;
+            while (std::getline(backtrace, line)) {
+                frames->push_back(TraceFrame{"", 0, line});
+            }
+        }
+        return frames;
+    }
+
+    void record_trace_locked(TraceEntry::Action action, void* ptr, size_t size, Frames frames) {
+        if (!g_history.config.record_trace || g_history.config.max_entries == 0) {
+            return;
+        }
+        // The executor has a single stream per device for now
+        TraceEntry entry{action, reinterpret_cast<uintptr_t>(ptr), size, 0, now_us(), std::move(frames)};
+        if (g_history.entries.size() < g_history.config.max_entries) {
+            g_history.entries.push_back(std::move(entry));
+        } else {
+            g_history.entries[g_history.next] = std::move(entry);
+            g_history.next = (g_history.next + 1) % g_history.entries.size();
+        }
+    }
+
+    // Host copy of an evicted storage. The storage's DataPtr owns it, so it
+    // goes away with the storage; the null data pointer makes any access
+    // that skipped ensure_resident() fail loudly instead of reading garbage.
+    struct EvictedBlock {
+        std::unique_ptr<char[]> data;
+        size_t nbytes;
+    };
+
+    void delete_evicted(void* ctx) {
+        auto* block = static_cast<EvictedBlock*>(ctx);
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            update_stat(g_memory_pool->stats.evicted_bytes, -static_cast<int64_t>(block->nbytes));
+        }
+        delete block;
+    }
+
     // Round size up to nearest power of 2 for better memory reuse
     size_t round_size_up(size_t size) {
         size_t rounded = 1;
@@ -54,24 +182,225 @@ namespace {
         }
         return rounded;
     }
+
+    void ensure_initialized_locked() {
+        if (!g_initialized) {
+            g_memory_pool = std::make_unique<MemoryPool>();
+            g_initialized = true;
+        }
+    }
+
+    void release_to_executor_locked(void* ptr, size_t size) {
+        update_stat(g_memory_pool->stats.segment, -1);
+        update_stat(g_memory_pool->stats.reserved_bytes, -static_cast<int64_t>(size));
+        record_trace_locked(TraceEntry::Action::SEGMENT_FREE, ptr, size, nullptr);
+        rpc_client::free_async(ptr);
+    }
+
+    void lru_remove_locked(LiveBlock& block) {
+        if (block.in_lru) {
+            g_lru.erase(block.lru_pos);
+            block.in_lru = false;
+        }
+    }
+
+    void track_storage_locked(void* data_ptr, c10::StorageImpl* storage) {
+        auto it = g_live_blocks.find(data_ptr);
+        if (it == g_live_blocks.end()) {
+            // Not allocated through the memory manager, cannot be evicted
+            return;
+        }
+        LiveBlock& block = it->second;
+        block.storage = c10::weak_intrusive_ptr<c10::StorageImpl>(
+            c10::intrusive_ptr<c10::StorageImpl>::reclaim_copy(storage));
+        block.last_used = std::chrono::steady_clock::now();
+        lru_remove_locked(block);
+        if (g_pins.count(storage)) {
+            // unpin_storage() makes it evictable again
+            return;
+        }
+        g_lru.push_front(data_ptr);
+        block.lru_pos = g_lru.begin();
+        block.in_lru = true;
+    }
+
+    // Release cached pool blocks, least recently used first, until the
+    // executor footprint is at most target bytes
+    void trim_pool_locked(size_t target) {
+        std::vector<MemoryBlock> cached;
+        for (const auto& bucket : g_memory_pool->free_blocks) {
+            cached.insert(cached.end(), bucket.second.begin(), bucket.second.end());
+        }
+        std::sort(cached.begin(), cached.end(), [](const MemoryBlock& a, const MemoryBlock& b) {
+            return a.last_used < b.last_used;
+        });
+        for (const MemoryBlock& block : cached) {
+            if (reserved_bytes_locked() <= target) {
+                break;
+            }
+            auto& bucket = g_memory_pool->free_blocks[block.size];
+            bucket.remove_if([&](const MemoryBlock& b) { return b.ptr == block.ptr; });
+            if (bucket.empty()) {
+                g_memory_pool->free_blocks.erase(block.size);
+            }
+            g_memory_pool->cache_bytes -= block.size;
+            release_to_executor_locked(block.ptr, block.size);
+        }
+    }
+
+    // Move the least recently used storage to client host memory.
+    // Returns false when nothing is left to evict.
+    bool evict_coldest() {
+        void* ptr = nullptr;
+        c10::intrusive_ptr<c10::StorageImpl> storage;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            while (!g_lru.empty() && !storage) {
+                ptr = g_lru.back();
+                LiveBlock& block = g_live_blocks.at(ptr);
+                lru_remove_locked(block);
+                storage = block.storage.lock();
+                if (storage && storage->data() != ptr) {
+                    // The storage moved to another block (e.g. resized)
+                    storage.reset();
+                }
+            }
+        }
+        if (!storage) {
+            return false;
+        }
+
+        const size_t nbytes = storage->nbytes();
+        auto evicted = std::make_unique<EvictedBlock>();
+        evicted->data.reset(new char[nbytes]);
+        evicted->nbytes = nbytes;
+        rpc_client::Error error = rpc_client::download_tensor_data(ptr, evicted->data.get(), nbytes);
+        if (error) {
+            SPDLOG_WARN("Evicting {} bytes failed: {}", nbytes, error.message());
+            return false;
+        }
+
+        // The returned DataPtr owns the executor block, letting it go out of
+        // scope after the lock is released hands the block back through free()
+        c10::DataPtr executor_block;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            if (g_pins.count(storage.get()) || storage->data() != ptr) {
+                // Pinned or moved while we were downloading, leave it be
+                return true;
+            }
+            update_stat(g_memory_pool->stats.evicted_bytes, static_cast<int64_t>(nbytes));
+            g_memory_pool->stats.num_evictions++;
+            g_memory_pool->transfer_bytes_from_remote += nbytes;
+            executor_block = storage->set_data_ptr(
+                c10::DataPtr(nullptr, evicted.release(), &delete_evicted, storage->device()));
+        }
+        return true;
+    }
+
+    // Under oversubscription, evict until needed more bytes fit below the
+    // low watermark once usage would cross the high watermark
+    void make_room(size_t needed) {
+        if (!g_oversubscription.load(std::memory_order_relaxed)) {
+            return;
+        }
+        size_t target;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            const double limit = static_cast<double>(g_config.device_memory_limit);
+            if (limit == 0 ||
+                reserved_bytes_locked() + needed <= g_config.high_watermark * limit) {
+                return;
+            }
+            target = static_cast<size_t>(g_config.low_watermark * limit);
+        }
+        const size_t target_before_alloc = target > needed ? target - needed : 0;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                trim_pool_locked(target_before_alloc);
+                if (reserved_bytes_locked() <= target_before_alloc) {
+                    return;
+                }
+            }
+            if (!evict_coldest()) {
+                return;
+            }
+        }
+    }
+
+    // exact only reuses cached blocks of exactly size bytes
+    void* allocate_block(size_t size, bool exact, const Frames& frames, rpc_client::Error* error) {
+        std::lock_guard<std::mutex> lock(g_mutex);
+
+        // Try to find a free block of suitable size
+        if (g_config.use_memory_pool && !g_memory_pool->free_blocks.empty()) {
+            auto& blocks = g_memory_pool->free_blocks;
+
+            // Find the smallest bucket that can fit this size
+            auto it = exact ? blocks.find(size) : blocks.lower_bound(size);
+            if (it != blocks.end() && !it->second.empty()) {
+                // Reuse an existing block
+                MemoryBlock block = it->second.front();
+                it->second.pop_front();
+
+                // If the bucket is now empty, remove it
+                if (it->second.empty()) {
+                    blocks.erase(it);
+                }
+
+                g_memory_pool->cache_bytes -= block.size;
+                g_memory_pool->cache_hits++;
+                g_live_blocks.emplace(block.ptr, LiveBlock(block.size, frames));
+                update_stat(g_memory_pool->stats.allocation, 1);
+                update_stat(g_memory_pool->stats.allocated_bytes, static_cast<int64_t>(block.size));
+                record_trace_locked(TraceEntry::Action::ALLOC, block.ptr, block.size, frames);
+                if (error) *error = rpc_client::Error::ok();
+                return block.ptr;
+            }
+        }
+
+        // No suitable free block found, allocate a new one
+        g_memory_pool->cache_misses++;
+        rpc_client::Error alloc_error;
+        void* ptr = rpc_client::alloc(size, &alloc_error);
+
+        if (alloc_error.is_ok()) {
+            DeviceStats& stats = g_memory_pool->stats;
+            update_stat(stats.segment, 1);
+            update_stat(stats.reserved_bytes, static_cast<int64_t>(size));
+            update_stat(stats.allocation, 1);
+            update_stat(stats.allocated_bytes, static_cast<int64_t>(size));
+            g_live_blocks.emplace(ptr, LiveBlock(size, frames));
+            record_trace_locked(TraceEntry::Action::SEGMENT_ALLOC, ptr, size, frames);
+            record_trace_locked(TraceEntry::Action::ALLOC, ptr, size, frames);
+        }
+
+        if (error) *error = alloc_error;
+        return ptr;
+    }
 }
 
 // Initialize memory management
 void init(const MemoryConfig& config) {
     std::lock_guard<std::mutex> lock(g_mutex);
+    TORCH_CHECK(config.low_watermark <= config.high_watermark,
+                "low_watermark must not exceed high_watermark");
     g_config = config;
+    rpc_client::configure_deferred_frees(config.deferred_frees);
+    g_oversubscription = config.enable_oversubscription;
 
-    if (!g_memory_pool) {
-        g_memory_pool = std::make_unique<MemoryPool>();
-    }
-
-    g_initialized = true;
+    ensure_initialized_locked();
 }
 
 // Tensor registration and tracking
 void register_tensor(void* data_ptr, const at::Tensor& tensor) {
     std::lock_guard<std::mutex> lock(g_mutex);
-    g_remote_tensors[data_ptr] = tensor;
+    ensure_initialized_locked();
+    g_remote_tensors.insert_or_assign(data_ptr, WeakTensorImpl(tensor.getIntrusivePtr()));
+    if (tensor.has_storage()) {
+        track_storage_locked(data_ptr, tensor.storage().unsafeGetStorageImpl());
+    }
 }
 
 void unregister_tensor(void* data_ptr) {
@@ -81,110 +410,234 @@ void unregister_tensor(void* data_ptr) {
 
 bool is_remote_tensor(void* data_ptr) {
     std::lock_guard<std::mutex> lock(g_mutex);
-    return g_remote_tensors.find(data_ptr) != g_remote_tensors.end();
+    auto it = g_remote_tensors.find(data_ptr);
+    return it != g_remote_tensors.end() && !it->second.expired();
 }
 
 at::Tensor get_tensor(void* data_ptr) {
     std::lock_guard<std::mutex> lock(g_mutex);
     auto it = g_remote_tensors.find(data_ptr);
-    if (it == g_remote_tensors.end()) {
+    c10::intrusive_ptr<c10::TensorImpl, c10::UndefinedTensorImpl> impl;
+    if (it != g_remote_tensors.end()) {
+        impl = it->second.lock();
+    }
+    if (!impl) {
         throw std::runtime_error("Tensor not found in remote tensor registry");
     }
-    return it->second;
+    return at::Tensor(std::move(impl));
 }
 
-// Memory pool management
-void* allocate(size_t size, rpc_client::Error* error) {
+void track_storage(void* data_ptr, c10::StorageImpl* storage) {
     std::lock_guard<std::mutex> lock(g_mutex);
+    track_storage_locked(data_ptr, storage);
+}
 
-    if (!g_initialized) {
-        init();
-    }
-
-    if (!g_config.use_memory_pool) {
-        return rpc_client::alloc(size, error);
-    }
-
-    // Round size up for better reuse
-    size_t rounded_size = round_size_up(size);
-
-    // Try to find a free block of suitable size
-    if (!g_memory_pool->free_blocks.empty()) {
-        auto& blocks = g_memory_pool->free_blocks;
-
-        // Find the smallest bucket that can fit this size
-        auto it = blocks.lower_bound(rounded_size);
-        if (it != blocks.end() && !it->second.empty()) {
-            // Reuse an existing block
-            MemoryBlock block = it->second.front();
-            it->second.pop_front();
-
-            // If the bucket is now empty, remove it
-            if (it->second.empty()) {
-                blocks.erase(it);
+// Memory pool management
+namespace {
+    void* allocate_sized(size_t block_size, bool exact, rpc_client::Error* error) {
+        const Frames frames = capture_stack(/*is_free=*/false);
+
+        make_room(block_size);
+        rpc_client::Error alloc_error;
+        void* ptr = allocate_block(block_size, exact, frames, &alloc_error);
+
+        // Out of executor memory: push cold tensors out to the host and retry
+        bool retried = false;
+        while (alloc_error && g_oversubscription.load(std::memory_order_relaxed) && evict_coldest()) {
+            {
+                std::lock_guard<std::mutex> lock(g_mutex);
+                trim_pool_locked(0);
+                if (!retried) {
+                    g_memory_pool->stats.num_alloc_retries++;
+                    retried = true;
+                }
             }
+            ptr = allocate_block(block_size, exact, frames, &alloc_error);
+        }
 
-            g_memory_pool->cache_hits++;
-            if (error) *error = rpc_client::Error::ok();
-            return block.ptr;
+        if (alloc_error) {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_memory_pool->stats.num_ooms++;
+            record_trace_locked(TraceEntry::Action::OOM, nullptr, block_size, frames);
         }
-    }
 
-    // No suitable free block found, allocate a new one
-    g_memory_pool->cache_misses++;
-    rpc_client::Error alloc_error;
-    void* ptr = rpc_client::alloc(rounded_size, &alloc_error);
+        if (error) *error = alloc_error;
+        return ptr;
+    }
+} // namespace
 
-    if (alloc_error.is_ok()) {
-        g_memory_pool->total_allocated += rounded_size;
-        g_memory_pool->peak_allocated = std::max(g_memory_pool->peak_allocated,
-                                               g_memory_pool->total_allocated);
+void* allocate(size_t size, rpc_client::Error* error) {
+    size_t block_size;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        ensure_initialized_locked();
+        // Round size up for better reuse
+        block_size = g_config.use_memory_pool ? round_size_up(size) : size;
     }
+    return allocate_sized(block_size, /*exact=*/false, error);
+}
 
-    if (error) *error = alloc_error;
-    return ptr;
+void* allocate_exact(size_t size, rpc_client::Error* error) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        ensure_initialized_locked();
+    }
+    return allocate_sized(size, /*exact=*/true, error);
 }
 
 void free(void* ptr) {
+    const Frames frames = capture_stack(/*is_free=*/true);
     std::lock_guard<std::mutex> lock(g_mutex);
 
-    if (!g_initialized || !g_config.use_memory_pool) {
-        rpc_client::free(ptr);
+    // Frees released to the executor are queued and shipped in one batch
+    // with the next outbound request instead of one blocking RPC each
+    auto it = g_live_blocks.find(ptr);
+    if (!g_initialized || it == g_live_blocks.end()) {
+        // We don't know its size, so just free it directly
+        rpc_client::free_async(ptr);
         return;
     }
 
-    // Find the tensor to get its size
-    auto it = g_remote_tensors.find(ptr);
-    if (it == g_remote_tensors.end()) {
-        // We don't know its size, so just free it directly
-        rpc_client::free(ptr);
+    const size_t block_size = it->second.size;
+    lru_remove_locked(it->second);
+    g_live_blocks.erase(it);
+    g_remote_tensors.erase(ptr);
+    update_stat(g_memory_pool->stats.allocation, -1);
+    update_stat(g_memory_pool->stats.allocated_bytes, -static_cast<int64_t>(block_size));
+    // No other stream can still be using the block, so the free completes at once
+    record_trace_locked(TraceEntry::Action::FREE_REQUESTED, ptr, block_size, frames);
+    record_trace_locked(TraceEntry::Action::FREE_COMPLETED, ptr, block_size, frames);
+
+    // Add to the free list if pool isn't too large
+    if (g_config.use_memory_pool &&
+        g_memory_pool->cache_bytes + block_size <= g_config.max_pool_size) {
+        g_memory_pool->free_blocks[block_size].emplace_front(ptr, block_size);
+        g_memory_pool->cache_bytes += block_size;
+    } else {
+        // Pool would be too large, just free the memory
+        release_to_executor_locked(ptr, block_size);
+    }
+}
+
+namespace {
+    // Record a use of storage, faulting it back in when it was evicted.
+    // Only one thread faults a storage in; the others wait for it.
+    void fault_in(c10::StorageImpl* storage) {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        g_fault_cv.wait(lock, [&] { return !g_faulting.count(storage); });
+        const c10::DataPtr& current = storage->data_ptr();
+
+        if (current.get_deleter() != &delete_evicted) {
+            // Resident, just record the use
+            auto it = g_live_blocks.find(current.get());
+            if (it != g_live_blocks.end() && it->second.in_lru) {
+                g_lru.splice(g_lru.begin(), g_lru, it->second.lru_pos);
+                it->second.last_used = std::chrono::steady_clock::now();
+            }
+            return;
+        }
+
+        // The host copy stays alive until we swap it out below: evictions
+        // skip storages that are not resident and other faults wait
+        auto* evicted = static_cast<EvictedBlock*>(current.get_context());
+        g_faulting.insert(storage);
+        lock.unlock();
+
+        // Possibly evicts colder storages to make room
+        rpc_client::Error error;
+        void* ptr = allocate(evicted->nbytes, &error);
+        if (!error) {
+            error = rpc_client::upload_tensor_data(ptr, evicted->data.get(), evicted->nbytes);
+            if (error) {
+                memory_manager::free(ptr);
+            }
+        }
+
+        // Destroying the old DataPtr after the lock is released frees the host copy
+        c10::DataPtr host_copy;
+        lock.lock();
+        g_faulting.erase(storage);
+        g_fault_cv.notify_all();
+        if (!error) {
+            g_memory_pool->stats.num_faults++;
+            g_memory_pool->transfer_bytes_to_remote += evicted->nbytes;
+            host_copy = storage->set_data_ptr(
+                c10::DataPtr(ptr, ptr, &memory_manager::free, storage->device()));
+            track_storage_locked(ptr, storage);
+        }
+        lock.unlock();
+        TORCH_CHECK(!error, "Faulting back an evicted tensor failed: ", error.message());
+    }
+} // namespace
+
+void ensure_resident(const at::Tensor& tensor) {
+    if (!tensor.defined() || !tensor.has_storage()) {
         return;
     }
+    ensure_resident(tensor.storage().unsafeGetStorageImpl());
+}
 
-    // Get the tensor size
-    at::Tensor& tensor = it->second;
-    size_t tensor_size = tensor.nbytes();
-    size_t rounded_size = round_size_up(tensor_size);
+void ensure_resident(c10::StorageImpl* storage) {
+    if (!g_oversubscription.load(std::memory_order_relaxed)) {
+        return;
+    }
+    fault_in(storage);
+}
 
-    // Add to the free list if pool isn't too large
-    size_t current_pool_size = std::accumulate(
-        g_memory_pool->free_blocks.begin(),
-        g_memory_pool->free_blocks.end(),
-        0ULL,
-        [](size_t sum, const auto& pair) {
-            return sum + pair.first * pair.second.size();
+void* pin_storage(c10::StorageImpl* storage) {
+    while (true) {
+        fault_in(storage);
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (g_faulting.count(storage) ||
+            storage->data_ptr().get_deleter() == &delete_evicted) {
+            // Evicted again before we got the lock
+            continue;
         }
-    );
+        ++g_pins[storage];
+        void* ptr = storage->mutable_data();
+        auto it = g_live_blocks.find(ptr);
+        if (it != g_live_blocks.end()) {
+            lru_remove_locked(it->second);
+        }
+        return ptr;
+    }
+}
 
-    if (current_pool_size + rounded_size <= g_config.max_pool_size) {
-        g_memory_pool->free_blocks[rounded_size].emplace_front(ptr, rounded_size);
-    } else {
-        // Pool would be too large, just free the memory
-        rpc_client::free(ptr);
+void unpin_storage(c10::StorageImpl* storage) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_pins.find(storage);
+    TORCH_CHECK(it != g_pins.end(), "unpin_storage() without a matching pin_storage()");
+    if (--it->second == 0) {
+        g_pins.erase(it);
+        // Tracks the block the storage lives on now, which a resize may have changed
+        track_storage_locked(storage->mutable_data(), storage);
     }
+}
 
-    // Remove from tensor map
-    g_remote_tensors.erase(it);
+bool try_extend(void* ptr, size_t new_size) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto it = g_live_blocks.find(ptr);
+    if (it == g_live_blocks.end()) {
+        return rpc_client::try_extend(ptr, new_size);
+    }
+    LiveBlock& block = it->second;
+    // Pool blocks are rounded up, growth often fits in the rounding slack
+    if (new_size <= block.size) {
+        return true;
+    }
+    if (!rpc_client::try_extend(ptr, new_size)) {
+        return false;
+    }
+    const int64_t growth = static_cast<int64_t>(new_size - block.size);
+    update_stat(g_memory_pool->stats.reserved_bytes, growth);
+    update_stat(g_memory_pool->stats.allocated_bytes, growth);
+    // Replayed as a free and a new allocation so trace viewers see the new size
+    record_trace_locked(TraceEntry::Action::FREE_COMPLETED, ptr, block.size, block.frames);
+    record_trace_locked(TraceEntry::Action::SEGMENT_FREE, ptr, block.size, nullptr);
+    record_trace_locked(TraceEntry::Action::SEGMENT_ALLOC, ptr, new_size, block.frames);
+    record_trace_locked(TraceEntry::Action::ALLOC, ptr, new_size, block.frames);
+    block.size = new_size;
+    return true;
 }
 
 void clear_cache() {
@@ -194,14 +647,16 @@ void clear_cache() {
         return;
     }
 
-    // Free all blocks in the memory pool
+    // Free all blocks in the memory pool as a single batch
     for (auto& pair : g_memory_pool->free_blocks) {
         for (auto& block : pair.second) {
-            rpc_client::free(block.ptr);
+            release_to_executor_locked(block.ptr, block.size);
         }
     }
+    rpc_client::flush_frees();
 
     g_memory_pool->free_blocks.clear();
+    g_memory_pool->cache_bytes = 0;
 }
 
 void clear_memory_pool() {
@@ -244,8 +699,10 @@ at::Tensor to_remote(const at::Tensor& tensor, int device_index, rpc_client::Err
     }
 
     // Update statistics
-    std::lock_guard<std::mutex> lock(g_mutex);
-    g_memory_pool->transfer_bytes_to_remote += tensor.nbytes();
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_memory_pool->transfer_bytes_to_remote += tensor.nbytes();
+    }
 
     // Create tensor that points to remote memory
     auto options = at::TensorOptions()
@@ -288,6 +745,8 @@ at::Tensor to_cpu(const at::Tensor& tensor, rpc_client::Error* error) {
         return cpu_tensor;
     }
 
+    ensure_resident(tensor);
+
     // Allocate CPU tensor
     at::Tensor cpu_tensor = at::empty(
         tensor.sizes().vec(),
@@ -335,26 +794,23 @@ MemoryStats get_stats() {
     std::lock_guard<std::mutex> lock(g_mutex);
 
     if (!g_initialized) {
-        return {0, 0, 0, 0, 0, 0, 0};
+        return {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
     }
 
-    size_t cache_size = std::accumulate(
-        g_memory_pool->free_blocks.begin(),
-        g_memory_pool->free_blocks.end(),
-        0ULL,
-        [](size_t sum, const auto& pair) {
-            return sum + pair.first * pair.second.size();
-        }
-    );
+    size_t cache_size = g_memory_pool->cache_bytes;
+    const DeviceStats& stats = g_memory_pool->stats;
 
     return {
-        g_memory_pool->total_allocated,
-        g_memory_pool->peak_allocated,
+        reserved_bytes_locked(),
+        static_cast<size_t>(stats.reserved_bytes.peak),
         cache_size,
-        g_memory_pool->total_allocated - cache_size,
+        reserved_bytes_locked() - cache_size,
         g_memory_pool->transfer_bytes_to_remote,
         g_memory_pool->transfer_bytes_from_remote,
-        static_cast<int>(g_remote_tensors.size())
+        static_cast<int>(g_remote_tensors.size()),
+        static_cast<size_t>(stats.evicted_bytes.current),
+        static_cast<size_t>(stats.num_evictions),
+        static_cast<size_t>(stats.num_faults)
     };
 }
 
@@ -370,7 +826,38 @@ void reset_stats() {
     g_memory_pool->cache_hits = 0;
     g_memory_pool->cache_misses = 0;
 
-    // Don't reset total_allocated since that's the current state, not just a stat
+    DeviceStats& stats = g_memory_pool->stats;
+    for (Stat* stat : {&stats.allocation, &stats.allocated_bytes, &stats.segment,
+                       &stats.reserved_bytes, &stats.evicted_bytes}) {
+        stat->allocated = 0;
+        stat->freed = 0;
+    }
+    stats.num_alloc_retries = 0;
+    stats.num_ooms = 0;
+    stats.num_evictions = 0;
+    stats.num_faults = 0;
+
+    // Don't reset current values since that's the current state, not just a stat
+}
+
+DeviceStats get_device_stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_initialized) {
+        return DeviceStats();
+    }
+    return g_memory_pool->stats;
+}
+
+void reset_peak_stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (!g_initialized) {
+        return;
+    }
+    DeviceStats& stats = g_memory_pool->stats;
+    for (Stat* stat : {&stats.allocation, &stats.allocated_bytes, &stats.segment,
+                       &stats.reserved_bytes, &stats.evicted_bytes}) {
+        stat->peak = stat->current;
+    }
 }
 
 void print_stats() {
@@ -384,7 +871,66 @@ void print_stats() {
     std::cout << "Transfer to remote: " << stats.transfer_bytes_to_remote / (1024.0 * 1024.0) << " MB\n";
     std::cout << "Transfer from remote: " << stats.transfer_bytes_from_remote / (1024.0 * 1024.0) << " MB\n";
     std::cout << "Active tensors: " << stats.active_tensors << "\n";
+    std::cout << "Evicted to host: " << stats.evicted_bytes / (1024.0 * 1024.0) << " MB\n";
+    std::cout << "Evictions / faults: " << stats.num_evictions << " / " << stats.num_faults << "\n";
     std::cout << "=====================================\n";
 }
 
+const char* action_name(TraceEntry::Action action) {
+    switch (action) {
+        case TraceEntry::Action::ALLOC: return "alloc";
+        case TraceEntry::Action::FREE_REQUESTED: return "free_requested";
+        case TraceEntry::Action::FREE_COMPLETED: return "free_completed";
+        case TraceEntry::Action::SEGMENT_ALLOC: return "segment_alloc";
+        case TraceEntry::Action::SEGMENT_FREE: return "segment_free";
+        case TraceEntry::Action::OOM: return "oom";
+    }
+    return "unknown";
+}
+
+void record_memory_history(const MemoryHistoryConfig& config) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // Start a fresh recording; a smaller buffer could not keep the old order anyway
+    g_history.config = config;
+    g_stack_flags.store(static_cast<uint8_t>((config.alloc_stacks ? kAllocStacks : 0) |
+                                             (config.free_stacks ? kFreeStacks : 0) |
+                                             (config.cpp_stacks ? kCppStacks : 0)),
+                        std::memory_order_relaxed);
+    g_history.entries.clear();
+    g_history.entries.shrink_to_fit();
+    g_history.next = 0;
+}
+
+void set_stack_gatherer(StackGatherer gatherer) {
+    g_stack_gatherer = gatherer;
+}
+
+MemorySnapshot snapshot() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    MemorySnapshot result;
+    if (!g_initialized) {
+        return result;
+    }
+
+    for (const auto& pair : g_live_blocks) {
+        result.segments.push_back(SegmentInfo{
+            reinterpret_cast<uintptr_t>(pair.first), pair.second.size, true, pair.second.frames});
+    }
+    for (const auto& bucket : g_memory_pool->free_blocks) {
+        for (const MemoryBlock& block : bucket.second) {
+            result.segments.push_back(SegmentInfo{
+                reinterpret_cast<uintptr_t>(block.ptr), block.size, false, nullptr});
+        }
+    }
+    std::sort(result.segments.begin(), result.segments.end(),
+              [](const SegmentInfo& a, const SegmentInfo& b) { return a.address < b.address; });
+
+    // Unroll the ring so the oldest event comes first
+    const std::vector<TraceEntry>& entries = g_history.entries;
+    result.trace.reserve(entries.size());
+    result.trace.insert(result.trace.end(), entries.begin() + g_history.next, entries.end());
+    result.trace.insert(result.trace.end(), entries.begin(), entries.begin() + g_history.next);
+    return result;
+}
+
 } // namespace memory_manager
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <torch/extension.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rpc_client.h"
+
+namespace memory_manager {
+
+struct MemoryConfig {
+    // Cache freed blocks on the client instead of releasing them on the executor
+    bool use_memory_pool = true;
+    // Upper bound on bytes kept in the pool
+    size_t max_pool_size = 1ULL << 30;
+    // Stage downloads through pinned host memory
+    bool use_pinned_memory = false;
+    // Batching of frees released to the executor
+    rpc_client::DeferredFreeConfig deferred_frees;
+
+    // Oversubscription: when executor memory runs short, move the least
+    // recently used tensors to client host memory and fault them back in
+    // on their next use
+    bool enable_oversubscription = false;
+    // Executor memory this client may use, 0 evicts only on allocation failure
+    size_t device_memory_limit = 0;
+    // Start evicting above high_watermark * limit, stop at low_watermark * limit
+    double high_watermark = 0.9;
+    double low_watermark = 0.75;
+};
+
+struct MemoryStats {
+    size_t total_allocated;
+    size_t peak_allocated;
+    size_t cache_size;
+    size_t pool_size;
+    size_t transfer_bytes_to_remote;
+    size_t transfer_bytes_from_remote;
+    int active_tensors;
+    size_t evicted_bytes;
+    size_t num_evictions;
+    size_t num_faults;
+};
+
+// Counter in the layout of the CUDA caching allocator's stats
+struct Stat {
+    int64_t current = 0;
+    int64_t peak = 0;
+    // Cumulative increases and decreases since the last reset_stats()
+    int64_t allocated = 0;
+    int64_t freed = 0;
+};
+
+// Per-device counters behind torch.remote_cuda.memory_stats()
+struct DeviceStats {
+    // Blocks handed out to tensors
+    Stat allocation;
+    Stat allocated_bytes;
+    // Executor allocations, including blocks cached in the pool
+    Stat segment;
+    Stat reserved_bytes;
+    // Tensor data moved to client host memory by oversubscription
+    Stat evicted_bytes;
+    // Allocations that only succeeded after evicting, and ones that failed
+    int64_t num_alloc_retries = 0;
+    int64_t num_ooms = 0;
+    int64_t num_evictions = 0;
+    int64_t num_faults = 0;
+};
+
+struct TraceFrame {
+    std::string filename;
+    int line = 0;
+    std::string name;
+};
+
+using Frames = std::shared_ptr<const std::vector<TraceFrame>>;
+
+// One allocator event, named as in torch.cuda.memory._snapshot() traces
+struct TraceEntry {
+    enum class Action {
+        ALLOC,
+        FREE_REQUESTED,
+        FREE_COMPLETED,
+        SEGMENT_ALLOC,
+        SEGMENT_FREE,
+        OOM,
+    };
+
+    Action action;
+    uintptr_t addr;
+    size_t size;
+    int64_t stream;
+    // Wall clock time in microseconds since the epoch
+    int64_t time_us;
+    Frames frames;
+};
+
+const char* action_name(TraceEntry::Action action);
+
+// One executor allocation; holds a single block since blocks are never split
+struct SegmentInfo {
+    uintptr_t address;
+    size_t size;
+    // False for blocks cached in the pool
+    bool allocated;
+    // Stack of the allocation that handed the block out, if recorded
+    Frames frames;
+};
+
+struct MemorySnapshot {
+    std::vector<SegmentInfo> segments;
+    // Oldest event first
+    std::vector<TraceEntry> trace;
+};
+
+struct MemoryHistoryConfig {
+    // Append allocator events to the trace ring buffer
+    bool record_trace = false;
+    // Capture stacks for allocations and for frees
+    bool alloc_stacks = false;
+    bool free_stacks = false;
+    // Add C++ frames to the interpreter frames
+    bool cpp_stacks = false;
+    // Oldest events are dropped beyond this many
+    size_t max_entries = 100000;
+};
+
+// Returns the interpreter stack of the calling thread, or nothing when it
+// cannot be inspected right now. Set by the Python bindings.
+using StackGatherer = std::vector<TraceFrame> (*)();
+
+// Initialize memory management
+void init(const MemoryConfig& config = MemoryConfig());
+
+// Tensor registration and tracking
+void register_tensor(void* data_ptr, const at::Tensor& tensor);
+void unregister_tensor(void* data_ptr);
+bool is_remote_tensor(void* data_ptr);
+at::Tensor get_tensor(void* data_ptr);
+// Make the storage living on data_ptr a candidate for eviction
+void track_storage(void* data_ptr, c10::StorageImpl* storage);
+
+// Record a use of tensor for LRU ordering and fault it back in if it was
+// evicted. Must run before anything touches the tensor's data.
+void ensure_resident(const at::Tensor& tensor);
+void ensure_resident(c10::StorageImpl* storage);
+// Fault storage back in and keep it off the eviction list until
+// unpin_storage(), so allocating meanwhile cannot evict it from under a
+// caller holding its data pointer. Pins nest. Returns the resident data
+// pointer.
+void* pin_storage(c10::StorageImpl* storage);
+void unpin_storage(c10::StorageImpl* storage);
+
+// Holds a pin on storage while in scope, a null storage is not pinned
+class PinnedStorage {
+public:
+    explicit PinnedStorage(c10::StorageImpl* storage)
+        : storage_(storage), data_(storage ? pin_storage(storage) : nullptr) {}
+    ~PinnedStorage() {
+        if (storage_) {
+            unpin_storage(storage_);
+        }
+    }
+    PinnedStorage(const PinnedStorage&) = delete;
+    PinnedStorage& operator=(const PinnedStorage&) = delete;
+
+    void* data() const { return data_; }
+
+private:
+    c10::StorageImpl* storage_;
+    void* data_;
+};
+
+// Memory pool management
+void* allocate(size_t size, rpc_client::Error* error = nullptr);
+// Allocate exactly size bytes, for large long-lived blocks such as loaded
+// weights where rounding up to a power of two could double the footprint
+void* allocate_exact(size_t size, rpc_client::Error* error = nullptr);
+void free(void* ptr);
+// Grow a block handed out by allocate() without moving it
+bool try_extend(void* ptr, size_t new_size);
+void clear_cache();
+void clear_memory_pool();
+
+// Tensor movement
+at::Tensor to_remote(const at::Tensor& tensor, int device_index = 0, rpc_client::Error* error = nullptr);
+at::Tensor to_cpu(const at::Tensor& tensor, rpc_client::Error* error = nullptr);
+
+// Statistics and diagnostics
+MemoryStats get_stats();
+DeviceStats get_device_stats();
+// Zero cumulative counters
+void reset_stats();
+// Set every peak to its current value
+void reset_peak_stats();
+void print_stats();
+
+// Allocation history
+void record_memory_history(const MemoryHistoryConfig& config);
+void set_stack_gatherer(StackGatherer gatherer);
+MemorySnapshot snapshot();
+
+} // namespace memory_manager
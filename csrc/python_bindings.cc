@@ -1,6 +1,11 @@
 #include <torch/extension.h>
+#include <frameobject.h>
 #include "remote_device.h"
 #include "remote_dispatch.h"
+#include "checkpoint_loader.h"
+#include "memory_manager.h"
+#include "remote_generator.h"
+#include "rpc_client.h"
 
 void setup_logging() {
 	try {
@@ -19,6 +24,119 @@ void setup_logging() {
 	}
 }
 
+// Runs inside tensor deleters, so Python errors are swallowed rather than thrown
+std::string code_attr(PyCodeObject* code, const char* name) {
+	PyObject* value = PyObject_GetAttrString(reinterpret_cast<PyObject*>(code), name);
+	const char* utf8 = value ? PyUnicode_AsUTF8(value) : nullptr;
+	std::string result = utf8 ? utf8 : "??";
+	if (!utf8) {
+		PyErr_Clear();
+	}
+	Py_XDECREF(value);
+	return result;
+}
+
+// Interpreter stack of the calling thread for allocation history, innermost
+// frame first. Allocations made without the GIL (e.g. checkpoint upload
+// threads) get no Python frames.
+std::vector<memory_manager::TraceFrame> gather_python_stack() {
+	std::vector<memory_manager::TraceFrame> frames;
+	if (!Py_IsInitialized() || !PyGILState_Check()) {
+		return frames;
+	}
+	PyFrameObject* frame = PyEval_GetFrame();
+	Py_XINCREF(frame);
+	while (frame) {
+		PyCodeObject* code = PyFrame_GetCode(frame);
+		frames.push_back(memory_manager::TraceFrame{
+				code_attr(code, "co_filename"), PyFrame_GetLineNumber(frame), code_attr(code, "co_name")});
+		Py_DECREF(code);
+		PyFrameObject* back = PyFrame_GetBack(frame);
+		Py_DECREF(frame);
+		frame = back;
+	}
+	return frames;
+}
+
+py::list frames_to_list(const memory_manager::Frames& frames) {
+	py::list result;
+	if (!frames) {
+		return result;
+	}
+	for (const memory_manager::TraceFrame& frame : *frames) {
+		py::dict entry;
+		entry["filename"] = frame.filename;
+		entry["line"] = frame.line;
+		entry["name"] = frame.name;
+		result.append(entry);
+	}
+	return result;
+}
+
+py::dict stat_to_dict(const memory_manager::Stat& stat) {
+	py::dict counters;
+	counters["current"] = stat.current;
+	counters["peak"] = stat.peak;
+	counters["allocated"] = stat.allocated;
+	counters["freed"] = stat.freed;
+	// Blocks are not split into pools, so every stat only has the "all" view
+	py::dict pools;
+	pools["all"] = counters;
+	return pools;
+}
+
+// Same shape as torch.cuda.memory._snapshot()
+py::dict snapshot_to_dict(const memory_manager::MemorySnapshot& snapshot) {
+	constexpr size_t kSmallSegmentSize = 1 << 20;
+	py::list segments;
+	for (const memory_manager::SegmentInfo& segment : snapshot.segments) {
+		const size_t used = segment.allocated ? segment.size : 0;
+		py::dict block;
+		block["address"] = segment.address;
+		block["size"] = segment.size;
+		block["requested_size"] = used;
+		block["state"] = segment.allocated ? "active_allocated" : "inactive";
+		block["frames"] = frames_to_list(segment.frames);
+
+		py::dict entry;
+		entry["device"] = 0;
+		entry["address"] = segment.address;
+		entry["total_size"] = segment.size;
+		entry["allocated_size"] = used;
+		entry["active_size"] = used;
+		entry["requested_size"] = used;
+		entry["stream"] = 0;
+		entry["segment_type"] = segment.size <= kSmallSegmentSize ? "small" : "large";
+		entry["segment_pool_id"] = py::make_tuple(0, 0);
+		entry["is_expandable"] = false;
+		entry["frames"] = py::list();
+		py::list blocks;
+		blocks.append(block);
+		entry["blocks"] = blocks;
+		segments.append(entry);
+	}
+
+	py::list trace;
+	for (const memory_manager::TraceEntry& event : snapshot.trace) {
+		py::dict entry;
+		entry["action"] = memory_manager::action_name(event.action);
+		entry["addr"] = event.addr;
+		entry["size"] = event.size;
+		entry["stream"] = event.stream;
+		entry["time_us"] = event.time_us;
+		entry["frames"] = frames_to_list(event.frames);
+		trace.append(entry);
+	}
+
+	py::dict result;
+	result["segments"] = segments;
+	// One trace per device; one pool serves every remote device for now
+	py::list device_traces;
+	device_traces.append(trace);
+	result["device_traces"] = device_traces;
+	return result;
+}
+
 // Create the Python module
 PYBIND11_MODULE(remote_cuda_ext, m) {
 		setup_logging();
@@ -34,4 +152,148 @@ PYBIND11_MODULE(remote_cuda_ext, m) {
 				"Register remote CUDA device type with PyTorch");
 		m.def("register_dispatch_keys", &remote_cuda::register_dispatch_keys,
 				"Register dispatcher keys for remote operations");
+		m.def("load_checkpoint",
+				[](const std::string& path, int device_index, int num_threads, size_t chunk_bytes) {
+					remote_cuda::CheckpointLoadOptions options;
+					options.device_index = device_index;
+					options.num_threads = num_threads;
+					options.chunk_bytes = chunk_bytes;
+					return remote_cuda::load_checkpoint(path, options);
+				},
+				"Stream a safetensors checkpoint from disk straight into remote memory",
+				py::arg("path"), py::arg("device_index") = 0, py::arg("num_threads") = 8,
+				py::arg("chunk_bytes") = 64ULL << 20,
+				py::call_guard<py::gil_scoped_release>());
+
+		m.def("configure_memory",
+				[](bool use_memory_pool, size_t max_pool_size, bool oversubscribe,
+						size_t device_memory_limit, double high_watermark, double low_watermark) {
+					memory_manager::MemoryConfig config;
+					config.use_memory_pool = use_memory_pool;
+					config.max_pool_size = max_pool_size;
+					config.enable_oversubscription = oversubscribe;
+					config.device_memory_limit = device_memory_limit;
+					config.high_watermark = high_watermark;
+					config.low_watermark = low_watermark;
+					memory_manager::init(config);
+				},
+				"Configure remote memory pooling and oversubscription",
+				py::arg("use_memory_pool") = true, py::arg("max_pool_size") = 1ULL << 30,
+				py::arg("oversubscribe") = false, py::arg("device_memory_limit") = 0,
+				py::arg("high_watermark") = 0.9, py::arg("low_watermark") = 0.75);
+
+		// Network emulation on the executor connection
+		m.def("configure_link",
+				[](bool enabled, double rtt_us, double jitter_us, double bandwidth_gbps,
+						size_t mtu_bytes, size_t packet_header_bytes, double per_packet_delay_us) {
+					rpc_client::LinkProfile profile;
+					profile.enabled = enabled;
+					profile.rtt = std::chrono::microseconds(static_cast<int64_t>(rtt_us));
+					profile.jitter = std::chrono::microseconds(static_cast<int64_t>(jitter_us));
+					profile.bandwidth_gbps = bandwidth_gbps;
+					profile.mtu_bytes = mtu_bytes;
+					profile.packet_header_bytes = packet_header_bytes;
+					profile.per_packet_delay = std::chrono::nanoseconds(static_cast<int64_t>(per_packet_delay_us * 1000));
+					rpc_client::configure_link(profile);
+				},
+				"Delay executor requests as if they crossed the described link",
+				py::arg("enabled") = false, py::arg("rtt_us") = 0.0, py::arg("jitter_us") = 0.0,
+				py::arg("bandwidth_gbps") = 0.0, py::arg("mtu_bytes") = 1500,
+				py::arg("packet_header_bytes") = 40, py::arg("per_packet_delay_us") = 0.0);
+		m.def("link_stats", []() {
+					rpc_client::LinkStats stats = rpc_client::link_stats();
+					py::dict result;
+					result["requests"] = stats.requests;
+					result["bytes_sent"] = stats.bytes_sent;
+					result["bytes_received"] = stats.bytes_received;
+					result["delay_s"] = std::chrono::duration<double>(stats.delay).count();
+					return result;
+				},
+				"Traffic and time spent on the emulated link");
+		m.def("reset_link_stats", &rpc_client::reset_link_stats,
+				"Zero the emulated link counters");
+
+		// Memory statistics and allocation history, shaped like torch.cuda's
+		memory_manager::set_stack_gatherer(&gather_python_stack);
+		m.def("memory_stats", []() {
+					memory_manager::DeviceStats stats = memory_manager::get_device_stats();
+					py::dict result;
+					result["allocation"] = stat_to_dict(stats.allocation);
+					result["allocated_bytes"] = stat_to_dict(stats.allocated_bytes);
+					result["segment"] = stat_to_dict(stats.segment);
+					result["reserved_bytes"] = stat_to_dict(stats.reserved_bytes);
+					result["evicted_bytes"] = stat_to_dict(stats.evicted_bytes);
+					result["num_alloc_retries"] = stats.num_alloc_retries;
+					result["num_ooms"] = stats.num_ooms;
+					result["num_evictions"] = stats.num_evictions;
+					result["num_faults"] = stats.num_faults;
+					return result;
+				},
+				"Remote memory counters as a nested dict");
+		m.def("reset_peak_memory_stats", &memory_manager::reset_peak_stats,
+				"Set every peak counter to its current value");
+		m.def("reset_accumulated_memory_stats", &memory_manager::reset_stats,
+				"Zero the cumulative memory counters");
+		m.def("record_memory_history",
+				[](bool record_trace, bool alloc_stacks, bool free_stacks, bool cpp_stacks, size_t max_entries) {
+					memory_manager::MemoryHistoryConfig config;
+					config.record_trace = record_trace;
+					config.alloc_stacks = alloc_stacks;
+					config.free_stacks = free_stacks;
+					config.cpp_stacks = cpp_stacks;
+					config.max_entries = max_entries;
+					memory_manager::record_memory_history(config);
+				},
+				"Start recording allocator events and stacks",
+				py::arg("record_trace"), py::arg("alloc_stacks"), py::arg("free_stacks"),
+				py::arg("cpp_stacks"), py::arg("max_entries"));
+		m.def("memory_snapshot", []() {
+					return snapshot_to_dict(memory_manager::snapshot());
+				},
+				"Segments and recorded allocator events");
+
+		// Random number generator state, mirrored on the client
+		m.def("manual_seed",
+				[](int64_t seed, int device_index) {
+					at::Generator gen = remote_cuda::getDefaultRemoteGenerator(device_index);
+					std::lock_guard<std::mutex> lock(gen.mutex());
+					// Negative seeds wrap around, as they do for CPU and CUDA generators
+					gen.set_current_seed(static_cast<uint64_t>(seed));
+				},
+				"Seed the default generator of a remote device",
+				py::arg("seed"), py::arg("device_index") = -1);
+		m.def("seed",
+				[](int device_index) {
+					at::Generator gen = remote_cuda::getDefaultRemoteGenerator(device_index);
+					std::lock_guard<std::mutex> lock(gen.mutex());
+					return gen.seed();
+				},
+				"Seed the default generator of a remote device with a random number",
+				py::arg("device_index") = -1);
+		m.def("initial_seed",
+				[](int device_index) {
+					return remote_cuda::getDefaultRemoteGenerator(device_index).current_seed();
+				},
+				"Current seed of the default generator of a remote device",
+				py::arg("device_index") = -1);
+		m.def("get_rng_state",
+				[](int device_index) {
+					at::Generator gen = remote_cuda::getDefaultRemoteGenerator(device_index);
+					std::lock_guard<std::mutex> lock(gen.mutex());
+					return gen.get_state();
+				},
+				"RNG state of a remote device as a ByteTensor",
+				py::arg("device_index") = -1);
+		m.def("set_rng_state",
+				[](const at::Tensor& state, int device_index) {
+					at::Generator gen = remote_cuda::getDefaultRemoteGenerator(device_index);
+					std::lock_guard<std::mutex> lock(gen.mutex());
+					gen.set_state(state);
+				},
+				"Restore the RNG state of a remote device",
+				py::arg("state"), py::arg("device_index") = -1);
+		m.def("device_count", []() {
+					return static_cast<int>(remote_cuda::RemoteCUDAGuardImpl().deviceCount());
+				},
+				"Number of remote devices");
 }
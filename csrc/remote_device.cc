@@ -1,4 +1,7 @@
 #include "remote_device.h"
+#include "remote_generator.h"
+#include "memory_manager.h"
+#include "rpc_client.h"
 #include <ATen/detail/PrivateUse1HooksInterface.h>
 #include <spdlog/spdlog.h>
 
@@ -7,11 +10,62 @@ namespace remote_cuda {
 // Register our device guard implementation
 C10_REGISTER_GUARD_IMPL(PrivateUse1, RemoteCUDAGuardImpl);
 
+class RemoteAllocator final : public c10::Allocator {
+	public:
+		c10::DataPtr allocate(size_t nbytes) override {
+			rpc_client::Error error;
+			void* ptr = memory_manager::allocate(nbytes, &error);
+			TORCH_CHECK(!error, "Remote allocation of ", nbytes, " bytes failed: ", error.message());
+			const c10::Device device = RemoteCUDAGuardImpl().getDevice();
+			return {ptr, ptr, &memory_manager::free, device};
+		}
+
+		c10::DeleterFnPtr raw_deleter() const override {
+			return &memory_manager::free;
+		}
+
+		void copy_data(void* dest, const void* src, std::size_t count) const override {
+			rpc_client::Error error = rpc_client::copy_remote(dest, src, count);
+			TORCH_CHECK(!error, "Remote copy failed: ", error.message());
+		}
+};
+
+static RemoteAllocator g_remote_allocator;
+REGISTER_ALLOCATOR(c10::DeviceType::PrivateUse1, &g_remote_allocator);
+
+c10::Allocator* get_remote_allocator() {
+	return &g_remote_allocator;
+}
+
+void resize_remote_storage_bytes(c10::StorageImpl* storage, size_t new_bytes) {
+	TORCH_CHECK(storage->resizable(), "Trying to resize remote storage that is not resizable");
+	// Allocating the new block may evict to make room, which must not move
+	// this storage's data to the host while we copy from it
+	memory_manager::PinnedStorage pinned(storage);
+	void* old_ptr = pinned.data();
+	const size_t old_bytes = storage->nbytes();
+
+	// Shrinking or growing into slack of the executor block keeps the data in place
+	if (new_bytes <= old_bytes || memory_manager::try_extend(old_ptr, new_bytes)) {
+		storage->set_nbytes(new_bytes);
+		return;
+	}
+
+	TORCH_CHECK(storage->allocator(), "Trying to resize remote storage without an allocator");
+	c10::DataPtr new_data = storage->allocator()->allocate(new_bytes);
+	if (old_ptr && old_bytes > 0) {
+		rpc_client::Error error = rpc_client::copy_remote(new_data.get(), old_ptr, old_bytes);
+		TORCH_CHECK(!error, "Remote storage resize failed: ", error.message());
+	}
+	// The pin is released on return, tracking the new block for eviction
+	storage->set_data_ptr_noswap(std::move(new_data));
+	storage->set_nbytes(new_bytes);
+}
+
 class RemoteCUDAPrivateUse1Hooks : public at::PrivateUse1HooksInterface {
 	public:
 		const at::Generator& getDefaultGenerator(c10::DeviceIndex device_index) const override {
-			static at::Generator generator;
-			return generator;
+			return getDefaultRemoteGenerator(device_index);
 		}
 
 		at::Device getDeviceFromPtr(void* data) const override {
@@ -35,7 +89,7 @@ class RemoteCUDAPrivateUse1Hooks : public at::PrivateUse1HooksInterface {
 		}
 
 		void resizePrivateUse1Bytes(const c10::Storage& storage, size_t newsize) const override {
-			// Update storage size if needed (not implemented here)
+			resize_remote_storage_bytes(storage.unsafeGetStorageImpl(), newsize);
 		}
 };
 
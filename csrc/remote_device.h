@@ -69,6 +69,14 @@ class RemoteCUDAGuardImpl final : public c10::impl::DeviceGuardImplInterface {
   }
 };
 
+// Allocator for remote device storage. Backs tensors created by the
+// dispatcher so their storages are resizable.
+c10::Allocator* get_remote_allocator();
+
+// Grow or shrink a remote storage to new_bytes, extending the block on the
+// executor when possible and copying executor-side otherwise
+void resize_remote_storage_bytes(c10::StorageImpl* storage, size_t new_bytes);
+
 // Function to register the device
 void register_device();
 
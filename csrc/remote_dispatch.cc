@@ -1,10 +1,14 @@
 #include "remote_dispatch.h"
+#include "memory_manager.h"
+#include "remote_generator.h"
+#include "transfer.h"
 
 #include "absl/container/flat_hash_set.h"
 #include <c10/core/SymIntArrayRef.h> 
 #include <c10/core/SymInt.h> 
 #include <ATen/native/CPUFallback.h>
 #include <c10/core/CPUAllocator.h>
+#include <ATen/EmptyTensor.h>
 
 /*
  * Fallback works for operators that do not have a more specific kernel registered for PrivateUse1 device.
@@ -15,6 +19,9 @@
 
 namespace remote_cuda {
 
+// Storage growth factor of resize_, amortizes repeated small appends
+constexpr double kStorageGrowthFactor = 2.0;
+
 at::ArrayRef<at::Tensor> extract_tensors(c10::Stack& stack) {
 	std::vector<at::Tensor> tensors;
 	for (const c10::IValue& value : stack) { // Iterate through the stack.  Consider only extracting the tensors for now.  This logic needs refined.
@@ -46,8 +53,6 @@ const absl::flat_hash_set<std::string> kLocalOps = {
 	"aten::println",   // CPU-specific: Printing a new line
 	"aten::set_printoptions", // CPU-specific: set printing options
 
-	"aten::empty.memory_format", //CPU-specific, allocate tensor based on cpu
-
 	// Add more operations as needed
 };
 
@@ -104,6 +109,9 @@ void remote_cuda_fallback(const c10::OperatorHandle& op, c10::Stack* stack) {
 				at::Tensor tensor = ivalue.toTensor();
 				if (tensor.device().type() != c10::DeviceType::PrivateUse1) {
 					ivalue = tensor.to(c10::Device(c10::DeviceType::PrivateUse1, 0));
+				} else {
+					// Fault back evicted inputs and mark them recently used
+					memory_manager::ensure_resident(tensor);
 				}
 			}
 		}
@@ -113,11 +121,6 @@ void remote_cuda_fallback(const c10::OperatorHandle& op, c10::Stack* stack) {
 	}
 }
 
-//TODO(Jae) complete this
-void* remote_allocate(size_t total_bytes){
-	return malloc(total_bytes);
-}
-
 void register_dispatch_keys() {
 	// Even though this is an empty function, calling this is critical
 	SPDLOG_INFO("Register dispatch keys called");
@@ -154,84 +157,97 @@ at::Tensor handle_empty_strided(c10::IntArrayRef size, c10::IntArrayRef stride,
 	TORCH_CHECK(!pin_memory_opt.has_value() || !pin_memory_opt.value(), 
 			"empty_strided: Pinned memory is not supported on remote_cuda");
 
-	// 2. Calculate the total size in bytes
-	int64_t num_elements = 1;
-	for (int64_t dim : size) {
-		num_elements *= dim;
-	}
-	size_t element_size = at::elementSize(scalar_type);
-	size_t total_bytes = num_elements * element_size;
-
-	// 3. Allocate memory on the remote device
-	//    (This is where you'd communicate with your remote server)
-	void* remote_ptr = remote_allocate(total_bytes);
+	// 2. Allocate remote storage sized for the strides through the remote
+	//    allocator, so the storage can later be resized in place
+	c10::DispatchKeySet key_set(REMOTE_CUDA_KEY);
+	at::Tensor tensor(at::detail::empty_strided_generic(size, stride, get_remote_allocator(), key_set, scalar_type));
 
-	// 4. Construct a TensorOptions object
-	at::TensorOptions options;
-	options = options.dtype(scalar_type);
-	options = options.layout(layout_opt.value_or(at::kStrided));
-	options = options.device(device_opt.value_or(c10::Device(REMOTE_CUDA_TYPE, 0))); // Important: Specify your custom device
-
-	// 5. Create a tensor from the remote memory
-	at::Tensor tensor = at::from_blob(remote_ptr, size, stride, options);
+	// 3. Track the storage so the memory manager can evict it under pressure
+	memory_manager::register_tensor(tensor.storage().mutable_data(), tensor);
 	return tensor;
 }
 
-at::Tensor handle_copy_from(const at::Tensor& self, const at::Tensor& dst, bool non_blocking) {
-		SPDLOG_INFO("[DEBUG] [Manual Kernel] copy_from called");
-    // Ensure the destination tensor is on your custom device
-    TORCH_CHECK(dst.device().type() == c10::DeviceType::PrivateUse1,
-                "_copy_from: Destination tensor must be on the REMOTE_CUDA device");
-
-    // Ensure the source tensor is not on your custom device
-    TORCH_CHECK(self.device().type() != c10::DeviceType::PrivateUse1,
-                "_copy_from: Source tensor must not be on the REMOTE_CUDA device");
-
-    // 1. Serialize the source tensor's data
-    const void* src_data = self.data_ptr();
-    size_t src_num_bytes = self.nbytes();
+// torch.empty, and everything built on it such as nn.Module parameters
+at::Tensor handle_empty_memory_format(c10::IntArrayRef size, c10::optional<at::ScalarType> dtype_opt,
+		c10::optional<c10::Layout> layout_opt, c10::optional<c10::Device> device_opt,
+		c10::optional<bool> pin_memory_opt, c10::optional<c10::MemoryFormat> memory_format_opt) {
+	SPDLOG_INFO("[DEBUG] empty.memory_format called");
+	TORCH_CHECK(device_opt.has_value() && device_opt->type() == REMOTE_CUDA_TYPE,
+			"empty: Expected device of type REMOTE_CUDA_TYPE");
+	TORCH_CHECK(layout_opt.value_or(c10::kStrided) == c10::kStrided,
+			"empty: Only supports strided layout");
+	TORCH_CHECK(!pin_memory_opt.has_value() || !pin_memory_opt.value(),
+			"empty: Pinned memory is not supported on remote_cuda");
+
+	c10::DispatchKeySet key_set(REMOTE_CUDA_KEY);
+	at::Tensor tensor(at::detail::empty_generic(size, get_remote_allocator(), key_set,
+			dtype_opt.value_or(at::kFloat), memory_format_opt));
+
+	memory_manager::register_tensor(tensor.storage().mutable_data(), tensor);
+	return tensor;
+}
 
-    // For demonstration, log the copy operation
-    SPDLOG_INFO("[DEBUG] [Manual Kernel] Copying {} bytes from CPU to REMOTE_CUDA device", src_num_bytes);
+// Storage to pin for a copy end, null when it is not remote
+static c10::StorageImpl* remote_storage(const at::Tensor& tensor, bool remote) {
+    return remote && tensor.has_storage() ? tensor.storage().unsafeGetStorageImpl() : nullptr;
+}
 
-    // 2. Allocate memory on the remote device (if not already allocated)
-    void* dest_data = dst.data_ptr();
-    TORCH_CHECK(dest_data, "_copy_from: Destination tensor's data pointer is null");
+// Route a copy by where its two ends live. Remote ends are faulted back in
+// and pinned for the whole copy: an evicted storage has a null data pointer,
+// and faulting in one end could otherwise evict the other.
+void copy_between(const char* op, const at::Tensor& src, const at::Tensor& dst) {
+    const bool src_remote = src.device().type() == c10::DeviceType::PrivateUse1;
+    const bool dst_remote = dst.device().type() == c10::DeviceType::PrivateUse1;
+    TORCH_CHECK(src_remote || dst_remote, op, ": Neither tensor is on the REMOTE_CUDA device");
+
+    memory_manager::PinnedStorage src_pin(remote_storage(src, src_remote));
+    memory_manager::PinnedStorage dst_pin(remote_storage(dst, dst_remote));
+    if (src_remote) {
+        TORCH_CHECK(src.data_ptr() || src.numel() == 0, op, ": Source tensor's data pointer is null");
+    }
+    if (dst_remote) {
+        TORCH_CHECK(dst.data_ptr() || dst.numel() == 0, op, ": Destination tensor's data pointer is null");
+    }
 
-    // 3. Simulate copying the data to the remote device
-    memcpy(dest_data, src_data, src_num_bytes);
+    // Only the live elements cross the link, and dtype conversion runs on the cheaper side
+    if (src_remote && dst_remote) {
+        copy_remote_to_remote(src, dst);
+    } else if (dst_remote) {
+        copy_host_to_remote(src, dst);
+    } else {
+        copy_remote_to_host(src, dst);
+    }
+}
 
-    // 4. Return the destination tensor
+at::Tensor handle_copy_from(const at::Tensor& self, const at::Tensor& dst, bool non_blocking) {
+		SPDLOG_INFO("[DEBUG] [Manual Kernel] copy_from called");
+    copy_between("_copy_from", self, dst);
     return dst;
 }
 
 at::Tensor& handle_copy_(at::Tensor& self, const at::Tensor& src, bool non_blocking) {
 		SPDLOG_INFO("[DEBUG] [Manual Kernel] copy_ called");
-    TORCH_CHECK(self.device().type() == c10::DeviceType::PrivateUse1,
-                "copy_: Destination tensor must be on the REMOTE_CUDA device");
-
-    TORCH_CHECK(src.device().type() != c10::DeviceType::PrivateUse1,
-                "copy_: Source tensor must not be on the REMOTE_CUDA device");
-
-    // 1. Serialize the source tensor's data
-    const void* src_data = src.data_ptr();
-    size_t src_num_bytes = src.nbytes();
-
-    // 2. Copy the data to the destination tensor
-    void* dest_data = self.data_ptr();
-    TORCH_CHECK(dest_data, "copy_: Destination tensor's data pointer is null");
-
-    memcpy(dest_data, src_data, src_num_bytes);
-
-    // 3. Return the modified destination tensor
+    // Also reached with a host self: a copy involving a remote tensor
+    // dispatches to the remote kernel whichever side it is on
+    copy_between("copy_", src, self);
     return self;
 }
 
 at::Tensor handle_to(const at::Tensor& self, c10::Device device, at::ScalarType dtype, bool non_blocking, bool copy) {
 		SPDLOG_INFO("[DEBUG] [Manual Kernel] to called");
     if (device.type() == c10::DeviceType::PrivateUse1) {
-        // Create a new tensor on the REMOTE_CUDA device
-        at::Tensor result = at::empty_strided(self.sizes(), self.strides(), self.options().device(device).dtype(dtype));
+        // Create a new tensor on the REMOTE_CUDA device. Keep the source
+        // layout only when it is dense, otherwise a strided view would
+        // allocate (and ship) the whole span it covers.
+        std::vector<int64_t> strides = self.strides().vec();
+        if (!self.is_non_overlapping_and_dense()) {
+            int64_t stride = 1;
+            for (int64_t d = self.dim() - 1; d >= 0; --d) {
+                strides[d] = stride;
+                stride *= std::max<int64_t>(self.size(d), 1);
+            }
+        }
+        at::Tensor result = at::empty_strided(self.sizes(), strides, self.options().device(device).dtype(dtype));
         return handle_copy_from(self, result, non_blocking);
     } else {
         TORCH_CHECK(false, "handle_to: Only supports moving to REMOTE_CUDA for now");
@@ -264,23 +280,121 @@ at::Tensor const& handle_resize_(at::Tensor const& self,
         );
     }
 
-    // Perform the resize operation
-    mutable_self.resize_(size_vec);
+    memory_manager::ensure_resident(mutable_self);
+
+    // Update the metadata, then make sure the storage covers it. Growth is
+    // geometric so an append-one-step-at-a-time loop (e.g. a KV cache)
+    // only reallocates O(log n) times.
+    at::TensorImpl* impl = mutable_self.unsafeGetTensorImpl();
+    impl->set_sizes_contiguous(size_vec);
+    if (impl->numel() > 0) {
+        const size_t needed = at::detail::computeStorageNbytesContiguous(
+            impl->sizes(), impl->dtype().itemsize(), impl->storage_offset());
+        c10::StorageImpl* storage = impl->unsafe_storage().unsafeGetStorageImpl();
+        if (needed > storage->nbytes()) {
+            const size_t grown = static_cast<size_t>(storage->nbytes() * kStorageGrowthFactor);
+            resize_remote_storage_bytes(storage, std::max(needed, grown));
+        }
+    }
 
     // Return the const reference as required by the signature
     return self;
 }
 
+//----------- Random Operations -----------
+// Only the (seed, offset) pair is sent; the executor generates the values
+// in place so random tensors never cross the wire.
+at::Tensor& handle_normal_(at::Tensor& self, double mean, double std,
+		c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] normal_ called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.normal_(mean, std, gen);
+	});
+	return self;
+}
+
+at::Tensor& handle_uniform_(at::Tensor& self, double from, double to,
+		c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] uniform_ called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.uniform_(from, to, gen);
+	});
+	return self;
+}
+
+at::Tensor& handle_bernoulli_(at::Tensor& self, double p,
+		c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] bernoulli_ called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.bernoulli_(p, gen);
+	});
+	return self;
+}
+
+at::Tensor& handle_random_(at::Tensor& self, c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] random_ called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.random_(gen);
+	});
+	return self;
+}
+
+// torch.randint(low, high) lands here
+at::Tensor& handle_random_from_(at::Tensor& self, int64_t from, c10::optional<int64_t> to,
+		c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] random_.from called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.random_(from, to, gen);
+	});
+	return self;
+}
+
+at::Tensor& handle_random_to_(at::Tensor& self, int64_t to, c10::optional<at::Generator> generator) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] random_.to called");
+	auto [seed, offset] = reserve_random_stream(self, generator);
+	executor_random_fill(self, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		t.random_(to, gen);
+	});
+	return self;
+}
+
+at::Tensor& handle_randperm_out(c10::SymInt n, c10::optional<at::Generator> generator, at::Tensor& out) {
+	SPDLOG_INFO("[DEBUG] [Manual Kernel] randperm.generator_out called");
+	const int64_t length = n.expect_int();
+	TORCH_CHECK(length >= 0, "randperm: n must be non-negative, got ", length);
+	if (out.numel() != length) {
+		out.resize_({length});
+	}
+	auto [seed, offset] = reserve_random_stream(out, generator);
+	executor_random_fill(out, seed, offset, [&](at::Tensor& t, at::Generator& gen) {
+		at::randperm_out(t, length, gen);
+	});
+	return out;
+}
+
 } // namespace remote_cuda
 
 
 //TORCH_LIBRARY_IMPL(aten, c10::DispatchKey::PrivateUse1, m) {
 TORCH_LIBRARY_IMPL(aten, PrivateUse1, m) {
 		m.impl("empty_strided", remote_cuda::handle_empty_strided);
+		m.impl("empty.memory_format", remote_cuda::handle_empty_memory_format);
 		m.impl("_copy_from", remote_cuda::handle_copy_from);
 		m.impl("to", remote_cuda::handle_to);
 		m.impl("resize_", remote_cuda::handle_resize_);
 		m.impl("copy_", remote_cuda::handle_copy_);
+		m.impl("normal_", remote_cuda::handle_normal_);
+		m.impl("uniform_", remote_cuda::handle_uniform_);
+		m.impl("bernoulli_.float", remote_cuda::handle_bernoulli_);
+		m.impl("random_", remote_cuda::handle_random_);
+		m.impl("random_.from", remote_cuda::handle_random_from_);
+		m.impl("random_.to", remote_cuda::handle_random_to_);
+		m.impl("randperm.generator_out", remote_cuda::handle_randperm_out);
 }
 
 TORCH_LIBRARY_IMPL(_, PrivateUse1, m) {
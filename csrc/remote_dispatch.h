@@ -24,6 +24,10 @@ at::Tensor handle_empty_strided(c10::IntArrayRef size,
 		c10::IntArrayRef stride, c10::optional<at::ScalarType> dtype_opt, 
 		c10::optional<c10::Layout> layout_opt, c10::optional<c10::Device> device_opt, 
 		c10::optional<bool> pin_memory_opt);
+at::Tensor handle_empty_memory_format(c10::IntArrayRef size,
+		c10::optional<at::ScalarType> dtype_opt, c10::optional<c10::Layout> layout_opt,
+		c10::optional<c10::Device> device_opt, c10::optional<bool> pin_memory_opt,
+		c10::optional<c10::MemoryFormat> memory_format_opt);
 //at::Tensor handle_binary_op(const char* op_name, const at::Tensor& self, const at::Tensor& other);
 //at::Tensor handle_unary_op(const char* op_name, const at::Tensor& self);
 //at::Tensor handle_view_op(const char* op_name, const at::Tensor& self, c10::ArrayRef<int64_t> sizes);
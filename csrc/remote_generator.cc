@@ -0,0 +1,129 @@
+#include "remote_generator.h"
+#include "memory_manager.h"
+
+#include <ATen/CPUGeneratorImpl.h>
+#include <ATen/core/GeneratorForPrivateuseone.h>
+
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace remote_cuda {
+
+namespace {
+
+constexpr size_t kStateSize = 2 * sizeof(uint64_t);
+
+uint64_t splitmix64(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+c10::DeviceIndex resolve_index(c10::DeviceIndex device_index) {
+	return device_index < 0 ? RemoteCUDAGuardImpl().getDevice().index() : device_index;
+}
+
+}  // namespace
+
+RemoteGeneratorImpl::RemoteGeneratorImpl(c10::DeviceIndex device_index)
+	: c10::GeneratorImpl(c10::Device(REMOTE_CUDA_TYPE, device_index),
+			c10::DispatchKeySet(c10::DispatchKey::PrivateUse1)) {}
+
+void RemoteGeneratorImpl::set_current_seed(uint64_t seed) {
+	seed_ = seed;
+	offset_ = 0;
+}
+
+void RemoteGeneratorImpl::set_offset(uint64_t offset) {
+	offset_ = offset;
+}
+
+uint64_t RemoteGeneratorImpl::get_offset() const {
+	return offset_;
+}
+
+uint64_t RemoteGeneratorImpl::current_seed() const {
+	return seed_;
+}
+
+uint64_t RemoteGeneratorImpl::seed() {
+	uint64_t random = c10::detail::getNonDeterministicRandom();
+	set_current_seed(random);
+	return random;
+}
+
+void RemoteGeneratorImpl::set_state(const c10::TensorImpl& new_state) {
+	at::detail::check_rng_state(new_state);
+	TORCH_CHECK(new_state.numel() == static_cast<int64_t>(kStateSize),
+			"RNG state is wrong size, expected ", kStateSize, " bytes");
+	const uint8_t* data = new_state.data_dtype_initialized<uint8_t>();
+	std::memcpy(&seed_, data, sizeof(uint64_t));
+	std::memcpy(&offset_, data + sizeof(uint64_t), sizeof(uint64_t));
+}
+
+c10::intrusive_ptr<c10::TensorImpl> RemoteGeneratorImpl::get_state() const {
+	at::Tensor state = at::empty({static_cast<int64_t>(kStateSize)}, at::TensorOptions().dtype(at::kByte));
+	uint8_t* data = state.data_ptr<uint8_t>();
+	std::memcpy(data, &seed_, sizeof(uint64_t));
+	std::memcpy(data + sizeof(uint64_t), &offset_, sizeof(uint64_t));
+	return state.getIntrusivePtr();
+}
+
+std::pair<uint64_t, uint64_t> RemoteGeneratorImpl::reserve_stream(uint64_t increment) {
+	uint64_t offset = offset_;
+	offset_ += increment;
+	return {seed_, offset};
+}
+
+RemoteGeneratorImpl* RemoteGeneratorImpl::clone_impl() const {
+	auto gen = new RemoteGeneratorImpl(device().index());
+	gen->seed_ = seed_;
+	gen->offset_ = offset_;
+	return gen;
+}
+
+const at::Generator& getDefaultRemoteGenerator(c10::DeviceIndex device_index) {
+	static std::once_flag init_flag;
+	static std::vector<at::Generator> default_generators;
+	std::call_once(init_flag, [] {
+		const c10::DeviceIndex num_devices = RemoteCUDAGuardImpl().deviceCount();
+		for (c10::DeviceIndex i = 0; i < num_devices; ++i) {
+			default_generators.push_back(at::make_generator<RemoteGeneratorImpl>(i));
+		}
+	});
+	device_index = resolve_index(device_index);
+	TORCH_CHECK(device_index < static_cast<c10::DeviceIndex>(default_generators.size()),
+			"Invalid remote_cuda device index ", device_index);
+	return default_generators[device_index];
+}
+
+at::Generator createRemoteGenerator(c10::DeviceIndex device_index) {
+	return at::make_generator<RemoteGeneratorImpl>(resolve_index(device_index));
+}
+
+std::pair<uint64_t, uint64_t> reserve_random_stream(const at::Tensor& self,
+		const c10::optional<at::Generator>& generator) {
+	auto* gen = at::get_generator_or_default<RemoteGeneratorImpl>(
+			generator, getDefaultRemoteGenerator(self.device().index()));
+	std::lock_guard<std::mutex> lock(gen->mutex_);
+	return gen->reserve_stream(static_cast<uint64_t>(self.numel()));
+}
+
+void executor_random_fill(const at::Tensor& self, uint64_t seed, uint64_t offset,
+		const std::function<void(at::Tensor&, at::Generator&)>& fill) {
+	memory_manager::ensure_resident(self);
+
+	// The executor is in-process for now, so its memory is reachable through
+	// a host view. Each (seed, offset) pair maps to its own generator stream.
+	at::Tensor target = at::from_blob(self.data_ptr(), self.sizes(), self.strides(),
+			at::TensorOptions().dtype(self.scalar_type()).device(at::kCPU));
+	at::Generator stream = at::make_generator<at::CPUGeneratorImpl>(splitmix64(seed ^ splitmix64(offset)));
+	fill(target, stream);
+}
+
+// torch.Generator(device="remote_cuda")
+REGISTER_GENERATOR_PRIVATEUSE1(createRemoteGenerator)
+
+}  // namespace remote_cuda
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <ATen/ATen.h>
+#include <ATen/core/Generator.h>
+#include <c10/core/GeneratorImpl.h>
+
+#include <functional>
+#include <utility>
+
+#include "remote_device.h"
+
+/*
+ * Random number generation for remote tensors.
+ * Each random op gets a (seed, offset) pair, the offset advancing by the
+ * number of elements the op draws, so the client only has to mirror those
+ * two integers. Seeding, get_state and set_state are local bookkeeping. A
+ * random op ships its (seed, offset) with the request, and the executor
+ * seeds a fresh CPU generator (mt19937) from a splitmix64 hash of the pair,
+ * so the values are produced where the tensor lives without ever crossing
+ * the wire.
+ */
+
+namespace remote_cuda {
+
+class RemoteGeneratorImpl : public c10::GeneratorImpl {
+	public:
+		explicit RemoteGeneratorImpl(c10::DeviceIndex device_index = 0);
+		~RemoteGeneratorImpl() override = default;
+
+		void set_current_seed(uint64_t seed) override;
+		void set_offset(uint64_t offset) override;
+		uint64_t get_offset() const override;
+		uint64_t current_seed() const override;
+		uint64_t seed() override;
+
+		// State is 16 bytes: seed then offset, both uint64
+		void set_state(const c10::TensorImpl& new_state) override;
+		c10::intrusive_ptr<c10::TensorImpl> get_state() const override;
+
+		// Advance the offset past increment values for one random op and
+		// return the (seed, offset) pair the executor seeds its stream from.
+		// Callers must hold mutex_.
+		std::pair<uint64_t, uint64_t> reserve_stream(uint64_t increment);
+
+		static c10::DeviceType device_type() { return REMOTE_CUDA_TYPE; }
+
+	private:
+		RemoteGeneratorImpl* clone_impl() const override;
+
+		uint64_t seed_ = c10::default_rng_seed_val;
+		uint64_t offset_ = 0;
+};
+
+// Default generator of a remote device, device_index -1 means current device
+const at::Generator& getDefaultRemoteGenerator(c10::DeviceIndex device_index = -1);
+
+// Fresh generator for torch.Generator(device="remote_cuda")
+at::Generator createRemoteGenerator(c10::DeviceIndex device_index = -1);
+
+// Advance the generator (or the device default) past one random op on self
+// and return the (seed, offset) pair for it
+std::pair<uint64_t, uint64_t> reserve_random_stream(const at::Tensor& self,
+		const c10::optional<at::Generator>& generator);
+
+// Runs on the executor: fill self in place from the stream (seed, offset).
+// fill receives a host view of the executor memory and a generator seeded
+// for this stream.
+void executor_random_fill(const at::Tensor& self, uint64_t seed, uint64_t offset,
+		const std::function<void(at::Tensor&, at::Generator&)>& fill);
+
+}  // namespace remote_cuda
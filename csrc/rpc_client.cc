@@ -0,0 +1,336 @@
+#include "rpc_client.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace rpc_client {
+
+namespace {
+
+//----------- In-process executor -----------
+void executor_free_batch(const std::vector<void*>& ptrs) {
+	for (void* ptr : ptrs) {
+		std::free(ptr);
+	}
+}
+
+//----------- Emulated link -----------
+using Clock = std::chrono::steady_clock;
+
+// Framing and fixed fields of every request and response
+constexpr size_t kMessageHeaderBytes = 64;
+// Below this, sleeping overshoots the deadline by more than the wait itself
+constexpr std::chrono::microseconds kSpinThreshold{200};
+
+struct Link {
+	std::mutex mutex;
+	LinkProfile profile;
+	// When each direction has finished serializing the messages queued on it
+	Clock::time_point uplink_free;
+	Clock::time_point downlink_free;
+	LinkStats stats;
+	std::mt19937_64 rng{0x5eed};
+};
+
+// Leaked for the same reason as deferred_frees()
+Link& link() {
+	static Link* instance = new Link();
+	return *instance;
+}
+
+Clock::duration serialization_delay(const LinkProfile& profile, size_t bytes) {
+	const size_t mtu = std::max<size_t>(profile.mtu_bytes, 1);
+	const size_t packets = std::max<size_t>((bytes + mtu - 1) / mtu, 1);
+	std::chrono::nanoseconds delay = profile.per_packet_delay * static_cast<int64_t>(packets);
+	if (profile.bandwidth_gbps > 0) {
+		const double wire_bits = 8.0 * (bytes + packets * profile.packet_header_bytes);
+		delay += std::chrono::nanoseconds(static_cast<int64_t>(wire_bits / profile.bandwidth_gbps));
+	}
+	return std::chrono::duration_cast<Clock::duration>(delay);
+}
+
+Clock::duration propagation_delay(Link& l) {
+	std::chrono::nanoseconds delay = l.profile.rtt / 2;
+	const int64_t jitter = std::chrono::nanoseconds(l.profile.jitter).count();
+	if (jitter > 0) {
+		delay += std::chrono::nanoseconds(std::uniform_int_distribution<int64_t>(-jitter, jitter)(l.rng));
+	}
+	return std::chrono::duration_cast<Clock::duration>(std::max(delay, std::chrono::nanoseconds(0)));
+}
+
+// Put bytes on one direction of the link once it is idle, returns when the
+// last byte leaves the sender. Caller holds l.mutex.
+Clock::time_point serialize(const Link& l, Clock::time_point* pipe_free, Clock::time_point ready, size_t bytes) {
+	*pipe_free = std::max(ready, *pipe_free) + serialization_delay(l.profile, bytes);
+	return *pipe_free;
+}
+
+void wait_until(Clock::time_point deadline) {
+	if (deadline - Clock::now() > kSpinThreshold) {
+		std::this_thread::sleep_until(deadline - kSpinThreshold);
+	}
+	while (Clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
+
+// Block the caller for one request and its response
+void round_trip(size_t request_bytes, size_t response_bytes) {
+	Link& l = link();
+	const Clock::time_point now = Clock::now();
+	Clock::time_point done;
+	{
+		std::lock_guard<std::mutex> lock(l.mutex);
+		if (!l.profile.enabled) {
+			return;
+		}
+		const Clock::time_point sent = serialize(l, &l.uplink_free, now, kMessageHeaderBytes + request_bytes);
+		const Clock::time_point arrived = sent + propagation_delay(l);
+		const Clock::time_point replied = serialize(l, &l.downlink_free, arrived, kMessageHeaderBytes + response_bytes);
+		done = replied + propagation_delay(l);
+
+		++l.stats.requests;
+		l.stats.bytes_sent += kMessageHeaderBytes + request_bytes;
+		l.stats.bytes_received += kMessageHeaderBytes + response_bytes;
+		l.stats.delay += std::chrono::duration_cast<std::chrono::nanoseconds>(done - now);
+	}
+	wait_until(done);
+}
+
+// Message without a response: the caller only waits for it to leave
+void send_one_way(size_t request_bytes) {
+	Link& l = link();
+	const Clock::time_point now = Clock::now();
+	Clock::time_point sent;
+	{
+		std::lock_guard<std::mutex> lock(l.mutex);
+		if (!l.profile.enabled) {
+			return;
+		}
+		sent = serialize(l, &l.uplink_free, now, kMessageHeaderBytes + request_bytes);
+
+		++l.stats.requests;
+		l.stats.bytes_sent += kMessageHeaderBytes + request_bytes;
+		l.stats.delay += std::chrono::duration_cast<std::chrono::nanoseconds>(sent - now);
+	}
+	wait_until(sent);
+}
+
+void ship_free_batch(const std::vector<void*>& ptrs) {
+	send_one_way(ptrs.size() * sizeof(void*));
+	executor_free_batch(ptrs);
+}
+
+//----------- Deferred frees -----------
+struct DeferredFrees {
+	std::mutex mutex;
+	std::condition_variable cv;
+	DeferredFreeConfig config;
+	std::vector<void*> pending;
+	std::chrono::steady_clock::time_point oldest;
+	bool flusher_started = false;
+};
+
+// Leaked on purpose: tensors may still be released during static destruction
+DeferredFrees& deferred_frees() {
+	static DeferredFrees* instance = new DeferredFrees();
+	return *instance;
+}
+
+std::vector<void*> take_pending_frees() {
+	DeferredFrees& frees = deferred_frees();
+	std::lock_guard<std::mutex> lock(frees.mutex);
+	std::vector<void*> batch;
+	batch.swap(frees.pending);
+	return batch;
+}
+
+// Attach queued frees to the request about to be sent. They were issued
+// before the request, so reclaiming them first keeps stream order.
+// Returns the bytes the batch adds to the request.
+size_t send_pending_frees() {
+	std::vector<void*> batch = take_pending_frees();
+	if (!batch.empty()) {
+		executor_free_batch(batch);
+	}
+	return batch.size() * sizeof(void*);
+}
+
+// Ships the queue once its oldest free has waited max_delay without a
+// request to ride on
+void flusher_loop() {
+	DeferredFrees& frees = deferred_frees();
+	std::unique_lock<std::mutex> lock(frees.mutex);
+	while (true) {
+		if (frees.pending.empty()) {
+			frees.cv.wait(lock);
+			continue;
+		}
+		const auto deadline = frees.oldest + frees.config.max_delay;
+		if (std::chrono::steady_clock::now() < deadline) {
+			frees.cv.wait_until(lock, deadline);
+			continue;
+		}
+		std::vector<void*> batch;
+		batch.swap(frees.pending);
+		lock.unlock();
+		ship_free_batch(batch);
+		lock.lock();
+	}
+}
+
+}  // namespace
+
+void configure_link(const LinkProfile& profile) {
+	Link& l = link();
+	std::lock_guard<std::mutex> lock(l.mutex);
+	l.profile = profile;
+	l.uplink_free = Clock::time_point();
+	l.downlink_free = Clock::time_point();
+}
+
+LinkProfile link_profile() {
+	Link& l = link();
+	std::lock_guard<std::mutex> lock(l.mutex);
+	return l.profile;
+}
+
+LinkStats link_stats() {
+	Link& l = link();
+	std::lock_guard<std::mutex> lock(l.mutex);
+	return l.stats;
+}
+
+void reset_link_stats() {
+	Link& l = link();
+	std::lock_guard<std::mutex> lock(l.mutex);
+	l.stats = LinkStats();
+}
+
+void* alloc(size_t size, Error* error) {
+	round_trip(send_pending_frees() + sizeof(size), sizeof(void*));
+	void* ptr = std::malloc(size);
+	if (!ptr && size > 0) {
+		if (error) *error = Error(Error::Code::ALLOCATION_FAILED,
+				"Executor could not allocate " + std::to_string(size) + " bytes");
+		return nullptr;
+	}
+	if (error) *error = Error::ok();
+	return ptr;
+}
+
+void free(void* ptr) {
+	std::vector<void*> batch = take_pending_frees();
+	batch.push_back(ptr);
+	ship_free_batch(batch);
+}
+
+void configure_deferred_frees(const DeferredFreeConfig& config) {
+	DeferredFrees& frees = deferred_frees();
+	{
+		std::lock_guard<std::mutex> lock(frees.mutex);
+		frees.config = config;
+	}
+	frees.cv.notify_one();
+	if (!config.enabled) {
+		flush_frees();
+	}
+}
+
+void free_async(void* ptr) {
+	if (!ptr) {
+		return;
+	}
+	DeferredFrees& frees = deferred_frees();
+	std::unique_lock<std::mutex> lock(frees.mutex);
+	if (!frees.config.enabled) {
+		lock.unlock();
+		free(ptr);
+		return;
+	}
+	if (frees.pending.empty()) {
+		frees.oldest = std::chrono::steady_clock::now();
+	}
+	frees.pending.push_back(ptr);
+
+	if (frees.pending.size() >= frees.config.max_batch) {
+		std::vector<void*> batch;
+		batch.swap(frees.pending);
+		lock.unlock();
+		ship_free_batch(batch);
+		return;
+	}
+
+	if (!frees.flusher_started) {
+		frees.flusher_started = true;
+		std::thread(flusher_loop).detach();
+	}
+	lock.unlock();
+	frees.cv.notify_one();
+}
+
+void flush_frees() {
+	std::vector<void*> batch = take_pending_frees();
+	if (!batch.empty()) {
+		ship_free_batch(batch);
+	}
+}
+
+size_t pending_frees() {
+	DeferredFrees& frees = deferred_frees();
+	std::lock_guard<std::mutex> lock(frees.mutex);
+	return frees.pending.size();
+}
+
+bool try_extend(void* ptr, size_t new_size) {
+	round_trip(send_pending_frees() + sizeof(ptr) + sizeof(new_size), 1);
+	// The in-process executor allocates with malloc, which often rounds a
+	// block up; that slack can be handed out without moving the data
+	return ptr && malloc_usable_size(ptr) >= new_size;
+}
+
+Error copy_remote(void* dst, const void* src, size_t nbytes) {
+	if (nbytes == 0) {
+		return Error::ok();
+	}
+	if (!dst || !src) {
+		return Error(Error::Code::INVALID_ARGUMENT, "copy_remote: null pointer");
+	}
+	round_trip(send_pending_frees() + 2 * sizeof(void*) + sizeof(nbytes), 0);
+	std::memmove(dst, src, nbytes);
+	return Error::ok();
+}
+
+Error upload_tensor_data(void* remote_ptr, const void* src, size_t nbytes) {
+	if (nbytes == 0) {
+		return Error::ok();
+	}
+	if (!remote_ptr || !src) {
+		return Error(Error::Code::INVALID_ARGUMENT, "upload_tensor_data: null pointer");
+	}
+	round_trip(send_pending_frees() + sizeof(remote_ptr) + sizeof(nbytes) + nbytes, 0);
+	std::memcpy(remote_ptr, src, nbytes);
+	return Error::ok();
+}
+
+Error download_tensor_data(const void* remote_ptr, void* dst, size_t nbytes) {
+	if (nbytes == 0) {
+		return Error::ok();
+	}
+	if (!remote_ptr || !dst) {
+		return Error(Error::Code::INVALID_ARGUMENT, "download_tensor_data: null pointer");
+	}
+	round_trip(send_pending_frees() + sizeof(remote_ptr) + sizeof(nbytes), nbytes);
+	std::memcpy(dst, remote_ptr, nbytes);
+	return Error::ok();
+}
+
+}  // namespace rpc_client
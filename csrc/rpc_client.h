@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Client side of the executor connection.
+ * The gRPC transport is not wired up yet (proto/remote.proto only has Ping),
+ * so the executor runs in-process: remote addresses are host allocations and
+ * transfers are memcpy. Callers must treat remote pointers as opaque.
+ */
+
+namespace rpc_client {
+
+class Error {
+	public:
+		enum class Code {
+			OK,
+			ALLOCATION_FAILED,
+			TRANSFER_FAILED,
+			INVALID_ARGUMENT,
+		};
+
+		Error() = default;
+		Error(Code code, std::string message)
+			: code_(code), message_(std::move(message)) {}
+
+		static Error ok() { return Error(); }
+
+		bool is_ok() const { return code_ == Code::OK; }
+		// True when the call failed
+		explicit operator bool() const { return !is_ok(); }
+
+		Code code() const { return code_; }
+		const std::string& message() const { return message_; }
+
+	private:
+		Code code_ = Code::OK;
+		std::string message_;
+};
+
+// Network emulation for the in-process executor. Every request is delayed
+// as if it crossed a link with the given properties, so transport settings
+// can be compared on one machine. Each direction is a separate pipe: a
+// message waits for earlier messages to finish serializing before it goes
+// on the wire, so concurrent transfers share the bandwidth.
+struct LinkProfile {
+	// Off by default, requests cost only the local copy
+	bool enabled = false;
+	// Round-trip propagation delay
+	std::chrono::microseconds rtt{0};
+	// Each one-way delay varies uniformly within +/- jitter
+	std::chrono::microseconds jitter{0};
+	// Bandwidth cap per direction in Gbit/s, 0 leaves serialization to
+	// the per-packet costs
+	double bandwidth_gbps = 0.0;
+	// Messages are cut into packets of at most mtu_bytes payload, each
+	// carrying packet_header_bytes on the wire and costing per_packet_delay
+	size_t mtu_bytes = 1500;
+	size_t packet_header_bytes = 40;
+	std::chrono::nanoseconds per_packet_delay{0};
+};
+
+void configure_link(const LinkProfile& profile);
+LinkProfile link_profile();
+
+struct LinkStats {
+	uint64_t requests = 0;
+	uint64_t bytes_sent = 0;
+	uint64_t bytes_received = 0;
+	// Time callers spent blocked on the emulated link
+	std::chrono::nanoseconds delay{0};
+};
+
+LinkStats link_stats();
+void reset_link_stats();
+
+// Allocate size bytes on the executor
+void* alloc(size_t size, Error* error = nullptr);
+
+// Release an executor allocation now, together with any queued frees
+void free(void* ptr);
+
+// Frees issued while tensors die are queued on the client and shipped as one
+// batch attached to the next outbound request. If no request goes out within
+// max_delay of the oldest queued free, a timer ships the batch on its own, so
+// no free waits longer than that. The executor reclaims a batch before
+// running the request it rides on, i.e. after everything issued earlier on
+// the stream.
+struct DeferredFreeConfig {
+	bool enabled = true;
+	// Flush as soon as this many frees are queued
+	size_t max_batch = 256;
+	// Longest the oldest queued free waits for a request to ride on
+	std::chrono::microseconds max_delay{5000};
+};
+
+void configure_deferred_frees(const DeferredFreeConfig& config);
+
+// Queue an executor allocation to be released with the next batch
+void free_async(void* ptr);
+
+// Ship queued frees now
+void flush_frees();
+
+// Number of frees waiting for the next batch
+size_t pending_frees();
+
+// Grow an executor allocation to new_size bytes without moving it.
+// Returns false, leaving the allocation untouched, when the block cannot
+// be extended in place.
+bool try_extend(void* ptr, size_t new_size);
+
+// Copy nbytes between executor allocations; the data never reaches the client
+Error copy_remote(void* dst, const void* src, size_t nbytes);
+
+// Copy nbytes from client memory to executor memory
+Error upload_tensor_data(void* remote_ptr, const void* src, size_t nbytes);
+
+// Copy nbytes from executor memory to client memory
+Error download_tensor_data(const void* remote_ptr, void* dst, size_t nbytes);
+
+}  // namespace rpc_client
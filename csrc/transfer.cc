@@ -0,0 +1,295 @@
+#include "transfer.h"
+#include "memory_manager.h"
+#include "rpc_client.h"
+
+#include <cstring>
+#include <memory>
+
+namespace remote_cuda {
+
+namespace {
+
+// Sizes and element strides with size-1 dims dropped and dims that are
+// contiguous with their inner neighbour merged. A transposed or sliced view
+// usually collapses to one or two dims.
+struct StridedLayout {
+	std::vector<int64_t> sizes;
+	std::vector<int64_t> strides;
+};
+
+StridedLayout coalesce(at::IntArrayRef sizes, at::IntArrayRef strides) {
+	StridedLayout layout;
+	for (size_t d = 0; d < sizes.size(); ++d) {
+		if (sizes[d] == 1) {
+			continue;
+		}
+		if (!layout.sizes.empty() && layout.strides.back() == strides[d] * sizes[d]) {
+			layout.sizes.back() *= sizes[d];
+			layout.strides.back() = strides[d];
+		} else {
+			layout.sizes.push_back(sizes[d]);
+			layout.strides.push_back(strides[d]);
+		}
+	}
+	if (layout.sizes.empty()) {
+		layout.sizes.push_back(1);
+		layout.strides.push_back(1);
+	}
+	return layout;
+}
+
+// Inner loops are kept branch-free over fixed-width element types so the
+// compiler can vectorize them
+template <typename T>
+void gather(const T* __restrict__ src, T* __restrict__ dst, int64_t n, int64_t stride) {
+	for (int64_t i = 0; i < n; ++i) {
+		dst[i] = src[i * stride];
+	}
+}
+
+template <typename T>
+void scatter(const T* __restrict__ src, T* __restrict__ dst, int64_t n, int64_t stride) {
+	for (int64_t i = 0; i < n; ++i) {
+		dst[i * stride] = src[i];
+	}
+}
+
+template <bool kPack>
+void copy_row(char* strided, char* dense, int64_t n, int64_t stride, size_t elem_size) {
+	if (stride == 1) {
+		if (kPack) {
+			std::memcpy(dense, strided, n * elem_size);
+		} else {
+			std::memcpy(strided, dense, n * elem_size);
+		}
+		return;
+	}
+	switch (elem_size) {
+		case 1:
+			kPack ? gather(reinterpret_cast<const uint8_t*>(strided), reinterpret_cast<uint8_t*>(dense), n, stride)
+				: scatter(reinterpret_cast<const uint8_t*>(dense), reinterpret_cast<uint8_t*>(strided), n, stride);
+			break;
+		case 2:
+			kPack ? gather(reinterpret_cast<const uint16_t*>(strided), reinterpret_cast<uint16_t*>(dense), n, stride)
+				: scatter(reinterpret_cast<const uint16_t*>(dense), reinterpret_cast<uint16_t*>(strided), n, stride);
+			break;
+		case 4:
+			kPack ? gather(reinterpret_cast<const uint32_t*>(strided), reinterpret_cast<uint32_t*>(dense), n, stride)
+				: scatter(reinterpret_cast<const uint32_t*>(dense), reinterpret_cast<uint32_t*>(strided), n, stride);
+			break;
+		case 8:
+			kPack ? gather(reinterpret_cast<const uint64_t*>(strided), reinterpret_cast<uint64_t*>(dense), n, stride)
+				: scatter(reinterpret_cast<const uint64_t*>(dense), reinterpret_cast<uint64_t*>(strided), n, stride);
+			break;
+		default:
+			// Complex types
+			for (int64_t i = 0; i < n; ++i) {
+				char* element = strided + i * stride * elem_size;
+				if (kPack) {
+					std::memcpy(dense + i * elem_size, element, elem_size);
+				} else {
+					std::memcpy(element, dense + i * elem_size, elem_size);
+				}
+			}
+			break;
+	}
+}
+
+// Walk every row of the coalesced layout, packing into or unpacking from
+// the dense buffer
+template <bool kPack>
+void strided_copy(char* strided_base, char* dense, const StridedLayout& layout, size_t elem_size) {
+	const size_t outer_dims = layout.sizes.size() - 1;
+	const int64_t inner_size = layout.sizes.back();
+	const int64_t inner_stride = layout.strides.back();
+	const size_t row_bytes = inner_size * elem_size;
+
+	std::vector<int64_t> index(outer_dims, 0);
+	int64_t offset = 0;
+	while (true) {
+		copy_row<kPack>(strided_base + offset * elem_size, dense, inner_size, inner_stride, elem_size);
+		dense += row_bytes;
+
+		// Advance the outer multi-index like an odometer
+		size_t d = outer_dims;
+		while (d > 0) {
+			--d;
+			offset += layout.strides[d];
+			if (++index[d] < layout.sizes[d]) {
+				break;
+			}
+			offset -= layout.strides[d] * layout.sizes[d];
+			index[d] = 0;
+			if (d == 0) {
+				return;
+			}
+		}
+		if (outer_dims == 0) {
+			return;
+		}
+	}
+}
+
+// Runs on the executor: scatter the staged dense elements into dst,
+// converting from staged_dtype when it differs from dst's dtype
+void executor_unpack(const void* staging, at::ScalarType staged_dtype, const at::Tensor& dst) {
+	if (staged_dtype == dst.scalar_type()) {
+		unpack_strided(staging, dst);
+		return;
+	}
+	// Executor memory is host memory while the executor is in-process, so
+	// the conversion is a CPU copy into a strided alias of dst
+	at::Tensor staged = at::from_blob(const_cast<void*>(staging), dst.sizes(),
+			at::TensorOptions().dtype(staged_dtype).device(at::kCPU));
+	at::Tensor target = at::from_blob(dst.data_ptr(), dst.sizes(), dst.strides(),
+			at::TensorOptions().dtype(dst.scalar_type()).device(at::kCPU));
+	target.copy_(staged);
+}
+
+// Runs on the executor: gather src's live elements into the dense staging
+// buffer, converting to staged_dtype when it differs from src's dtype
+void executor_pack(const at::Tensor& src, at::ScalarType staged_dtype, void* staging) {
+	if (staged_dtype == src.scalar_type()) {
+		pack_strided(src, staging);
+		return;
+	}
+	at::Tensor source = at::from_blob(src.data_ptr(), src.sizes(), src.strides(),
+			at::TensorOptions().dtype(src.scalar_type()).device(at::kCPU));
+	at::Tensor staged = at::from_blob(staging, src.sizes(),
+			at::TensorOptions().dtype(staged_dtype).device(at::kCPU));
+	staged.copy_(source);
+}
+
+}  // namespace
+
+void pack_strided(const at::Tensor& src, void* dst) {
+	if (src.numel() == 0) {
+		return;
+	}
+	strided_copy<true>(static_cast<char*>(src.data_ptr()), static_cast<char*>(dst),
+			coalesce(src.sizes(), src.strides()), src.element_size());
+}
+
+void unpack_strided(const void* src, const at::Tensor& dst) {
+	if (dst.numel() == 0) {
+		return;
+	}
+	strided_copy<false>(static_cast<char*>(dst.data_ptr()), static_cast<char*>(const_cast<void*>(src)),
+			coalesce(dst.sizes(), dst.strides()), dst.element_size());
+}
+
+bool cast_before_transfer(at::ScalarType src_dtype, at::ScalarType dst_dtype) {
+	return at::elementSize(dst_dtype) < at::elementSize(src_dtype);
+}
+
+void copy_host_to_remote(const at::Tensor& src, const at::Tensor& dst) {
+	at::Tensor host = src.device().is_cpu() ? src : src.to(at::kCPU);
+	if (host.sizes() != dst.sizes()) {
+		// Broadcast with zero strides, packing materializes only dst.numel() elements
+		host = host.expand(dst.sizes());
+	}
+	if (host.scalar_type() != dst.scalar_type() && cast_before_transfer(host.scalar_type(), dst.scalar_type())) {
+		// Narrowing conversion, cheaper to ship the converted elements
+		host = host.to(dst.scalar_type());
+	}
+
+	const size_t nbytes = dst.numel() * host.element_size();
+	if (nbytes == 0) {
+		return;
+	}
+	// Allocating staging below can evict under oversubscription, keep dst on the executor
+	memory_manager::PinnedStorage pinned(dst.storage().unsafeGetStorageImpl());
+
+	// Dense source with the same layout and dtype as dst: one straight upload
+	if (host.scalar_type() == dst.scalar_type() && host.is_contiguous() && dst.is_contiguous()) {
+		rpc_client::Error error = rpc_client::upload_tensor_data(dst.data_ptr(), host.data_ptr(), nbytes);
+		TORCH_CHECK(!error, "copy_: upload failed: ", error.message());
+		return;
+	}
+
+	std::unique_ptr<char[]> packed;
+	const void* payload = host.data_ptr();
+	if (!host.is_contiguous()) {
+		packed.reset(new char[nbytes]);
+		pack_strided(host, packed.get());
+		payload = packed.get();
+	}
+
+	// Staging goes through the memory manager so it shows up in the memory
+	// stats and can make room by evicting other storages under oversubscription
+	rpc_client::Error error;
+	void* staging = memory_manager::allocate(nbytes, &error);
+	TORCH_CHECK(!error, "copy_: staging allocation failed: ", error.message());
+	error = rpc_client::upload_tensor_data(staging, payload, nbytes);
+	if (!error) {
+		executor_unpack(staging, host.scalar_type(), dst);
+	}
+	memory_manager::free(staging);
+	TORCH_CHECK(!error, "copy_: upload failed: ", error.message());
+}
+
+void copy_remote_to_host(const at::Tensor& src, const at::Tensor& dst) {
+	TORCH_CHECK(dst.device().is_cpu(), "copy_: remote tensors can only be copied to CPU, got ", dst.device());
+	const at::Tensor remote = src.sizes() != dst.sizes() ? src.expand(dst.sizes()) : src;
+	const at::ScalarType staged_dtype = cast_before_transfer(remote.scalar_type(), dst.scalar_type())
+		? dst.scalar_type() : remote.scalar_type();
+	const size_t nbytes = dst.numel() * at::elementSize(staged_dtype);
+	if (nbytes == 0) {
+		return;
+	}
+	// Allocating staging below can evict under oversubscription, keep src on the executor
+	memory_manager::PinnedStorage pinned(remote.storage().unsafeGetStorageImpl());
+
+	// Dense source in the shipped dtype goes out as is, anything else is
+	// packed (and narrowed) on the executor first
+	rpc_client::Error error;
+	const void* payload = remote.data_ptr();
+	void* staging = nullptr;
+	if (!remote.is_contiguous() || staged_dtype != remote.scalar_type()) {
+		staging = memory_manager::allocate(nbytes, &error);
+		TORCH_CHECK(!error, "copy_: staging allocation failed: ", error.message());
+		executor_pack(remote, staged_dtype, staging);
+		payload = staging;
+	}
+
+	// Land straight in dst when it has the shipped layout and dtype
+	const bool direct = staged_dtype == dst.scalar_type() && dst.is_contiguous();
+	std::unique_ptr<char[]> landing;
+	void* host = dst.data_ptr();
+	if (!direct) {
+		landing.reset(new char[nbytes]);
+		host = landing.get();
+	}
+	error = rpc_client::download_tensor_data(payload, host, nbytes);
+	if (staging) {
+		memory_manager::free(staging);
+	}
+	TORCH_CHECK(!error, "copy_: download failed: ", error.message());
+
+	if (!direct) {
+		at::Tensor staged = at::from_blob(host, dst.sizes(),
+				at::TensorOptions().dtype(staged_dtype).device(at::kCPU));
+		dst.copy_(staged);
+	}
+}
+
+void copy_remote_to_remote(const at::Tensor& src, const at::Tensor& dst) {
+	const at::Tensor source = src.sizes() != dst.sizes() ? src.expand(dst.sizes()) : src;
+	if (dst.numel() == 0) {
+		return;
+	}
+	if (source.scalar_type() == dst.scalar_type() && source.is_contiguous() && dst.is_contiguous()) {
+		rpc_client::Error error = rpc_client::copy_remote(dst.data_ptr(), source.data_ptr(), dst.nbytes());
+		TORCH_CHECK(!error, "copy_: remote copy failed: ", error.message());
+		return;
+	}
+	// Strided or converting copy, run by the executor on host aliases of
+	// its memory while it is in-process
+	at::Tensor from = at::from_blob(source.data_ptr(), source.sizes(), source.strides(),
+			at::TensorOptions().dtype(source.scalar_type()).device(at::kCPU));
+	at::Tensor to = at::from_blob(dst.data_ptr(), dst.sizes(), dst.strides(),
+			at::TensorOptions().dtype(dst.scalar_type()).device(at::kCPU));
+	to.copy_(from);
+}
+
+}  // namespace remote_cuda
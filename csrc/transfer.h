@@ -0,0 +1,36 @@
+#pragma once
+
+#include <ATen/ATen.h>
+
+/*
+ * Tensor transfer between the client and the executor.
+ * Only the live elements of a view are shipped: the sending side packs a
+ * non-contiguous source into a dense staging buffer and the receiving side
+ * scatters it into the destination using its strided descriptor. A dtype
+ * conversion runs on whichever side of the link sends fewer bytes.
+ */
+
+namespace remote_cuda {
+
+// Gather the elements of a strided host tensor into a dense buffer of
+// src.numel() * src.element_size() bytes, in row-major order
+void pack_strided(const at::Tensor& src, void* dst);
+
+// Scatter a dense row-major buffer into the memory described by dst's
+// sizes, strides and storage offset
+void unpack_strided(const void* src, const at::Tensor& dst);
+
+// True when the conversion src_dtype -> dst_dtype should run on the client,
+// i.e. when it shrinks the payload
+bool cast_before_transfer(at::ScalarType src_dtype, at::ScalarType dst_dtype);
+
+// Copy a host tensor (broadcastable to dst) into the remote tensor dst
+void copy_host_to_remote(const at::Tensor& src, const at::Tensor& dst);
+
+// Copy a remote tensor (broadcastable to dst) into the host tensor dst
+void copy_remote_to_host(const at::Tensor& src, const at::Tensor& dst);
+
+// Copy between two remote tensors without the data reaching the client
+void copy_remote_to_remote(const at::Tensor& src, const at::Tensor& dst);
+
+}  // namespace remote_cuda
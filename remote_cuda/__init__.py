@@ -63,8 +63,46 @@ except Exception as e:
     sys.exit(1)
 
 
+# Emulated links for benchmarking transport settings on one machine.
+# Values are typical for the link class, not measurements of our clusters.
+LINK_PROFILES = {
+    "loopback": {},
+    "same_rack": {"rtt_us": 10, "jitter_us": 2, "bandwidth_gbps": 100},
+    "same_datacenter": {"rtt_us": 200, "jitter_us": 50, "bandwidth_gbps": 25},
+    "cross_datacenter": {"rtt_us": 10000, "jitter_us": 1000, "bandwidth_gbps": 10},
+    "cross_region": {"rtt_us": 70000, "jitter_us": 5000, "bandwidth_gbps": 1},
+}
+
+_LINK_OPTIONS = {
+    "rtt_us", "jitter_us", "bandwidth_gbps", "mtu_bytes",
+    "packet_header_bytes", "per_packet_delay_us",
+}
+
+def configure_link(link_profile="loopback", **overrides):
+    """
+    Emulate a network link between this client and the executor
+
+    Args:
+        link_profile (str): Name of an entry in LINK_PROFILES to start from
+        **overrides: Link properties replacing the profile's values, see init()
+    """
+    if link_profile not in LINK_PROFILES:
+        raise ValueError(f"Unknown link profile '{link_profile}', "
+                         f"expected one of {sorted(LINK_PROFILES)}")
+    options = dict(LINK_PROFILES[link_profile], **overrides)
+    enabled = link_profile != "loopback" or bool(overrides)
+    _ext.configure_link(enabled=enabled, **options)
+
+def link_stats():
+    """Requests, bytes and seconds spent on the emulated link since the last reset"""
+    return _ext.link_stats()
+
+def reset_link_stats():
+    """Zero the emulated link counters"""
+    _ext.reset_link_stats()
+
 # Initialize with a no-op function for initial build testing
-def init(server_address="localhost:50051"):
+def init(server_address="localhost:50051", **kwargs):
     """
     Initialize connection to remote GPU server
     
@@ -76,12 +114,113 @@ def init(server_address="localhost:50051"):
             - enable_reconnect (bool): Enable automatic reconnection
             - max_reconnect_attempts (int): Maximum number of reconnection attempts
             - use_compression (bool): Enable data compression
+            - use_memory_pool (bool): Cache freed remote blocks on the client
+            - max_pool_size (int): Upper bound in bytes on the cached blocks
+            - oversubscribe (bool): Evict least recently used tensors to host
+              memory instead of failing when remote memory runs short
+            - device_memory_limit (int): Remote memory budget in bytes,
+              0 evicts only when an allocation fails
+            - high_watermark (float): Fraction of the budget that starts eviction
+            - low_watermark (float): Fraction of the budget eviction stops at
+            - link_profile (str): Emulate a link from LINK_PROFILES on every
+              executor request (default: "loopback", no delay)
+            - rtt_us (float): Round-trip time in microseconds
+            - jitter_us (float): Each one-way delay varies within +/- jitter_us
+            - bandwidth_gbps (float): Bandwidth cap per direction, 0 for none
+            - mtu_bytes (int): Largest packet payload
+            - packet_header_bytes (int): Wire overhead per packet
+            - per_packet_delay_us (float): Processing delay per packet
     
     Returns:
         bool: True if connection was successful, False otherwise
     """
+    memory_options = {
+        "use_memory_pool", "max_pool_size", "oversubscribe",
+        "device_memory_limit", "high_watermark", "low_watermark",
+    }
+    _ext.configure_memory(**{k: v for k, v in kwargs.items() if k in memory_options})
+    configure_link(kwargs.get("link_profile", "loopback"),
+                   **{k: v for k, v in kwargs.items() if k in _LINK_OPTIONS})
     return True
 
+def load_checkpoint(path, device_index=0, num_threads=8, chunk_bytes=64 << 20):
+    """
+    Load a safetensors checkpoint directly into remote device memory
+
+    The file is memory-mapped and every tensor's byte range is uploaded
+    straight from the mapping, so no CPU copy of the weights is made.
+
+    Args:
+        path (str): Path to a .safetensors file
+        device_index (int): Remote device to place the tensors on
+        num_threads (int): Number of tensors uploaded concurrently
+        chunk_bytes (int): Each tensor is uploaded in chunks of this size
+
+    Returns:
+        dict: Tensor name to remote tensor, in file order
+    """
+    return dict(_ext.load_checkpoint(path, device_index=device_index,
+                                     num_threads=num_threads, chunk_bytes=chunk_bytes))
+
+def _seed_arg(seed):
+    # Seeds are 64 bit and taken as int64 like torch.Generator.manual_seed,
+    # so fold the upper half of the uint64 range onto negative values
+    seed = int(seed)
+    return seed - (1 << 64) if seed >= (1 << 63) else seed
+
+def manual_seed(seed):
+    """Seed the random number generator of the current remote device"""
+    _ext.manual_seed(_seed_arg(seed))
+
+def manual_seed_all(seed):
+    """Seed the random number generators of all remote devices"""
+    for index in range(_ext.device_count()):
+        _ext.manual_seed(_seed_arg(seed), index)
+
+def seed():
+    """Seed the current remote device with a non-deterministic random number"""
+    _ext.seed()
+
+def seed_all():
+    """Seed all remote devices with one non-deterministic random number"""
+    manual_seed_all(_ext.seed(0))
+
+def initial_seed():
+    """Return the current seed of the current remote device"""
+    return _ext.initial_seed()
+
+def get_rng_state(device=-1):
+    """
+    Return the RNG state of a remote device as a ByteTensor
+
+    The state is the (seed, offset) pair the executor generates random
+    values from, so reading it does not contact the server.
+    """
+    return _ext.get_rng_state(device)
+
+def set_rng_state(new_state, device=-1):
+    """Restore the RNG state of a remote device"""
+    _ext.set_rng_state(new_state, device)
+
+from . import memory
+from .memory import (
+    memory_stats,
+    memory_allocated,
+    max_memory_allocated,
+    memory_reserved,
+    max_memory_reserved,
+    reset_peak_memory_stats,
+    reset_accumulated_memory_stats,
+    memory_snapshot,
+)
+
+def _is_in_bad_fork():
+    """
+    torch.manual_seed() only seeds a device module that has this hook.
+    The executor connection holds no state that breaks across fork().
+    """
+    return False
+
 def is_available():
     """Check if remote CUDA is available"""
     # Placeholder implementation
@@ -91,6 +230,24 @@ def is_available():
 class RemoteCudaModule:
     def __init__(self):
         self.is_available = is_available
+        self.load_checkpoint = load_checkpoint
+        self.manual_seed = manual_seed
+        self.manual_seed_all = manual_seed_all
+        self.seed = seed
+        self.seed_all = seed_all
+        self.initial_seed = initial_seed
+        self.get_rng_state = get_rng_state
+        self.set_rng_state = set_rng_state
+        self._is_in_bad_fork = _is_in_bad_fork
+        self.memory = memory
+        self.memory_stats = memory_stats
+        self.memory_allocated = memory_allocated
+        self.max_memory_allocated = max_memory_allocated
+        self.memory_reserved = memory_reserved
+        self.max_memory_reserved = max_memory_reserved
+        self.reset_peak_memory_stats = reset_peak_memory_stats
+        self.reset_accumulated_memory_stats = reset_accumulated_memory_stats
+        self.memory_snapshot = memory_snapshot
         self.__version__ = "0.1.0"
         self.device = REMOTE_CUDA
         self.name = REMOTE_CUDA
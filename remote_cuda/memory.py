@@ -0,0 +1,124 @@
+"""
+Remote memory statistics and allocation history
+
+Mirrors torch.cuda.memory so tooling written against CUDA devices (e.g.
+https://pytorch.org/memory_viz for _dump_snapshot() files) works on
+remote_cuda devices. One memory pool serves every remote device for now,
+so the device arguments are accepted for compatibility only.
+"""
+import collections
+import pickle
+
+from . import _ext
+
+__all__ = [
+    "memory_stats",
+    "memory_allocated",
+    "max_memory_allocated",
+    "memory_reserved",
+    "max_memory_reserved",
+    "reset_peak_memory_stats",
+    "reset_accumulated_memory_stats",
+    "memory_snapshot",
+]
+
+
+def memory_stats(device=None):
+    """
+    Return a dictionary of remote memory allocator statistics
+
+    Keys follow torch.cuda.memory_stats(), e.g. "allocated_bytes.all.current".
+    Besides "allocation", "allocated_bytes", "segment" and "reserved_bytes",
+    "evicted_bytes", "num_evictions" and "num_faults" report tensors moved
+    to host memory by oversubscription.
+    """
+    result = []
+
+    def _recurse_add_to_result(prefix, obj):
+        if isinstance(obj, dict):
+            if len(prefix) > 0:
+                prefix += "."
+            for k, v in obj.items():
+                _recurse_add_to_result(prefix + k, v)
+        else:
+            result.append((prefix, obj))
+
+    _recurse_add_to_result("", _ext.memory_stats())
+    result.sort()
+    return collections.OrderedDict(result)
+
+
+def memory_allocated(device=None):
+    """Bytes of remote memory currently occupied by tensors"""
+    return memory_stats(device).get("allocated_bytes.all.current", 0)
+
+
+def max_memory_allocated(device=None):
+    """Peak bytes occupied by tensors since the last reset_peak_memory_stats()"""
+    return memory_stats(device).get("allocated_bytes.all.peak", 0)
+
+
+def memory_reserved(device=None):
+    """Bytes of remote memory held by the allocator, including cached blocks"""
+    return memory_stats(device).get("reserved_bytes.all.current", 0)
+
+
+def max_memory_reserved(device=None):
+    """Peak bytes held by the allocator since the last reset_peak_memory_stats()"""
+    return memory_stats(device).get("reserved_bytes.all.peak", 0)
+
+
+def reset_peak_memory_stats(device=None):
+    """Reset the "peak" counters to their current values"""
+    _ext.reset_peak_memory_stats()
+
+
+def reset_accumulated_memory_stats(device=None):
+    """Reset the "allocated" and "freed" counters and the event counts"""
+    _ext.reset_accumulated_memory_stats()
+
+
+def memory_snapshot():
+    """Return the remote memory segments, as torch.cuda.memory_snapshot() does"""
+    return _ext.memory_snapshot()["segments"]
+
+
+def _record_memory_history(enabled="all", context="all", stacks="all",
+                           max_entries=100000, device=None):
+    """
+    Record allocator events with their stacks for _snapshot()
+
+    Args:
+        enabled (str): None stops recording, "state" keeps only the stacks
+            of live blocks, "all" also keeps a trace of alloc/free events
+        context (str): Stacks to capture, None, "state" or "alloc" for
+            allocations only, "all" for allocations and frees
+        stacks (str): "python" for interpreter frames, "all" adds C++ frames
+        max_entries (int): Size of the trace ring buffer, older events are
+            dropped once it is full
+    """
+    if enabled not in (None, "state", "all"):
+        raise ValueError(f"enabled must be None, 'state' or 'all', got {enabled!r}")
+    if context not in (None, "state", "alloc", "all"):
+        raise ValueError(f"context must be None, 'state', 'alloc' or 'all', got {context!r}")
+    if stacks not in ("python", "all"):
+        raise ValueError(f"stacks must be 'python' or 'all', got {stacks!r}")
+    if enabled is None:
+        context = None
+    _ext.record_memory_history(
+        record_trace=enabled == "all",
+        alloc_stacks=context is not None,
+        free_stacks=context == "all",
+        cpp_stacks=stacks == "all",
+        max_entries=max_entries)
+
+
+def _snapshot(device=None):
+    """Return {"segments": ..., "device_traces": ...} like torch.cuda.memory._snapshot()"""
+    return _ext.memory_snapshot()
+
+
+def _dump_snapshot(filename="dump_snapshot.pickle"):
+    """Pickle _snapshot() to filename for the memory visualizer"""
+    with open(filename, "wb") as f:
+        pickle.dump(_snapshot(), f)
@@ -0,0 +1,163 @@
+#include "csrc/batch_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+
+namespace remote_cuda {
+namespace {
+
+using std::chrono::milliseconds;
+
+// Doubles its input and records the rows of every run
+struct DoubleProgram {
+	std::mutex mutex;
+	std::vector<int64_t> run_rows;
+
+	ProgramFn fn() {
+		return [this](const std::vector<at::Tensor>& inputs) {
+			std::lock_guard<std::mutex> lock(mutex);
+			run_rows.push_back(inputs[0].size(0));
+			return std::vector<at::Tensor>{inputs[0] * 2};
+		};
+	}
+};
+
+at::Tensor rows_of(int64_t rows, float value) {
+	return at::full({rows, 3}, value);
+}
+
+TEST(BatchSchedulerTest, MergesAndSplitsAcrossSessions) {
+	BatchSchedulerConfig config;
+	config.max_batch_size = 6;
+	config.max_queue_delay = milliseconds(10000);
+	BatchScheduler scheduler(config);
+	DoubleProgram program;
+	scheduler.register_program("double", program.fn());
+
+	// 2 + 3 + 1 rows fill the batch, so it runs without waiting for the deadline
+	auto a = scheduler.submit(1, "double", {rows_of(2, 1)});
+	auto b = scheduler.submit(2, "double", {rows_of(3, 2)});
+	auto c = scheduler.submit(3, "double", {rows_of(1, 3)});
+
+	EXPECT_TRUE(at::equal(a.get()[0], rows_of(2, 2)));
+	EXPECT_TRUE(at::equal(b.get()[0], rows_of(3, 4)));
+	EXPECT_TRUE(at::equal(c.get()[0], rows_of(1, 6)));
+	EXPECT_EQ(program.run_rows, std::vector<int64_t>({6}));
+
+	BatchSchedulerStats stats = scheduler.stats();
+	EXPECT_EQ(stats.requests, 3u);
+	EXPECT_EQ(stats.batches, 1u);
+	EXPECT_EQ(stats.batched_rows, 6u);
+}
+
+TEST(BatchSchedulerTest, CapsRequestsPerSession) {
+	BatchSchedulerConfig config;
+	// The queue only fills with the fifth request, and the deadline never
+	// passes, so the first batch sees all five requests
+	config.max_batch_size = 5;
+	config.max_queue_delay = milliseconds(60000);
+	config.max_requests_per_session = 2;
+	BatchScheduler scheduler(config);
+	DoubleProgram program;
+	scheduler.register_program("double", program.fn());
+
+	std::vector<std::future<std::vector<at::Tensor>>> results;
+	for (int i = 0; i < 4; ++i) {
+		results.push_back(scheduler.submit(1, "double", {rows_of(1, i)}));
+	}
+	results.push_back(scheduler.submit(2, "double", {rows_of(1, 10)}));
+	// Flushes the two requests left behind by the cap
+	scheduler.shutdown();
+	for (auto& result : results) {
+		result.get();
+	}
+
+	// Session 1 gets two slots next to session 2, its other two wait for the next batch
+	EXPECT_EQ(program.run_rows, std::vector<int64_t>({3, 2}));
+}
+
+TEST(BatchSchedulerTest, FlushesPartialBatchAtDeadline) {
+	BatchSchedulerConfig config;
+	config.max_batch_size = 100;
+	config.max_queue_delay = milliseconds(20);
+	BatchScheduler scheduler(config);
+	DoubleProgram program;
+	scheduler.register_program("double", program.fn());
+
+	// Holds the dispatcher until both requests are queued, so they merge
+	// however long submitting takes
+	std::promise<void> entered;
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	scheduler.register_program("gate", [&](const std::vector<at::Tensor>& inputs) {
+		entered.set_value();
+		released.wait();
+		return inputs;
+	});
+	auto gate = scheduler.submit(0, "gate", {rows_of(config.max_batch_size, 0)});
+	entered.get_future().wait();
+
+	const auto start = std::chrono::steady_clock::now();
+	auto a = scheduler.submit(1, "double", {rows_of(2, 1)});
+	auto b = scheduler.submit(2, "double", {rows_of(2, 1)});
+	EXPECT_EQ(a.wait_for(milliseconds(0)), std::future_status::timeout);
+	release.set_value();
+	gate.get();
+
+	EXPECT_TRUE(at::equal(a.get()[0], rows_of(2, 2)));
+	EXPECT_TRUE(at::equal(b.get()[0], rows_of(2, 2)));
+	EXPECT_GE(std::chrono::steady_clock::now() - start, config.max_queue_delay);
+	EXPECT_EQ(program.run_rows, std::vector<int64_t>({4}));
+}
+
+TEST(BatchSchedulerTest, FailsUnsplittableBatchWithoutReplay) {
+	BatchSchedulerConfig config;
+	// Dispatched once full, never at the deadline
+	config.max_batch_size = 4;
+	config.max_queue_delay = milliseconds(60000);
+	BatchScheduler scheduler(config);
+	std::atomic<int> runs{0};
+	// Reduces over the batch but claims to be batchable
+	scheduler.register_program("sum", [&](const std::vector<at::Tensor>& inputs) {
+		runs++;
+		return std::vector<at::Tensor>{inputs[0].sum(0)};
+	});
+
+	auto a = scheduler.submit(1, "sum", {rows_of(2, 1)});
+	auto b = scheduler.submit(2, "sum", {rows_of(2, 1)});
+	EXPECT_THROW(a.get(), c10::Error);
+	EXPECT_THROW(b.get(), c10::Error);
+	EXPECT_EQ(runs.load(), 1);
+	EXPECT_EQ(scheduler.stats().unsplittable_batches, 1u);
+}
+
+TEST(BatchSchedulerTest, RunsUnbatchableProgramPerRequest) {
+	BatchScheduler scheduler;
+	std::atomic<int> runs{0};
+	scheduler.register_program("sum", [&](const std::vector<at::Tensor>& inputs) {
+		runs++;
+		return std::vector<at::Tensor>{inputs[0].sum(0)};
+	}, /*batchable=*/false);
+
+	auto a = scheduler.submit(1, "sum", {rows_of(2, 1)});
+	auto b = scheduler.submit(2, "sum", {rows_of(3, 1)});
+	EXPECT_TRUE(at::equal(a.get()[0], at::full({3}, 2.0f)));
+	EXPECT_TRUE(at::equal(b.get()[0], at::full({3}, 3.0f)));
+	EXPECT_EQ(runs.load(), 2);
+
+	BatchSchedulerStats stats = scheduler.stats();
+	EXPECT_EQ(stats.unbatched_requests, 2u);
+	EXPECT_EQ(stats.batches, 0u);
+}
+
+TEST(BatchSchedulerTest, RejectsUnknownProgram) {
+	BatchScheduler scheduler;
+	EXPECT_THROW(scheduler.submit(1, "missing", {rows_of(1, 0)}), c10::Error);
+}
+
+}  // namespace
+}  // namespace remote_cuda
@@ -0,0 +1,92 @@
+#include "csrc/rpc_client.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace rpc_client {
+namespace {
+
+using std::chrono::milliseconds;
+
+class DeferredFreeTest : public ::testing::Test {
+	protected:
+		void configure(size_t max_batch, std::chrono::microseconds max_delay) {
+			DeferredFreeConfig config;
+			config.max_batch = max_batch;
+			config.max_delay = max_delay;
+			configure_deferred_frees(config);
+			flush_frees();
+		}
+
+		void TearDown() override {
+			configure_deferred_frees(DeferredFreeConfig());
+			flush_frees();
+		}
+
+		std::vector<void*> allocate(size_t count) {
+			std::vector<void*> ptrs;
+			for (size_t i = 0; i < count; ++i) {
+				ptrs.push_back(alloc(64));
+			}
+			return ptrs;
+		}
+};
+
+TEST_F(DeferredFreeTest, ShipsWhenBatchFills) {
+	configure(4, milliseconds(10000));
+	std::vector<void*> ptrs = allocate(4);
+
+	for (size_t i = 0; i < 3; ++i) {
+		free_async(ptrs[i]);
+		EXPECT_EQ(pending_frees(), i + 1);
+	}
+	free_async(ptrs[3]);
+	EXPECT_EQ(pending_frees(), 0u);
+}
+
+TEST_F(DeferredFreeTest, RidesOnNextRequest) {
+	configure(256, milliseconds(10000));
+	std::vector<void*> ptrs = allocate(2);
+	free_async(ptrs[0]);
+	free_async(ptrs[1]);
+	EXPECT_EQ(pending_frees(), 2u);
+
+	void* next = alloc(64);
+	EXPECT_EQ(pending_frees(), 0u);
+	free(next);
+}
+
+TEST_F(DeferredFreeTest, TimerDrainsAfterMaxDelay) {
+	configure(256, milliseconds(50));
+	std::vector<void*> ptrs = allocate(2);
+	free_async(ptrs[0]);
+	free_async(ptrs[1]);
+
+	std::this_thread::sleep_for(milliseconds(10));
+	EXPECT_EQ(pending_frees(), 2u);
+
+	std::this_thread::sleep_for(milliseconds(200));
+	EXPECT_EQ(pending_frees(), 0u);
+}
+
+TEST_F(DeferredFreeTest, DisabledFreesAtOnce) {
+	DeferredFreeConfig config;
+	config.enabled = false;
+	configure_deferred_frees(config);
+
+	free_async(alloc(64));
+	EXPECT_EQ(pending_frees(), 0u);
+}
+
+TEST_F(DeferredFreeTest, FlushShipsQueue) {
+	configure(256, milliseconds(10000));
+	free_async(alloc(64));
+	EXPECT_EQ(pending_frees(), 1u);
+	flush_frees();
+	EXPECT_EQ(pending_frees(), 0u);
+}
+
+}  // namespace
+}  // namespace rpc_client
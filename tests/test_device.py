@@ -1,3 +1,7 @@
+import json
+import os
+import struct
+import tempfile
 import torch
 import remote_cuda
 import unittest
@@ -29,3 +33,247 @@ class TestRemoteCUDA(unittest.TestCase):
         # Test device transfer handling
         cpu_tensor = torch.tensor([1.0, 2.0, 3.0])
         remote_tensor = cpu_tensor.to(self.device)
+
+    def test_load_checkpoint(self):
+        # Hand-written safetensors file: 8-byte header length, JSON header, data
+        weight = torch.arange(6, dtype=torch.float32)
+        bias = torch.arange(3, dtype=torch.int64)
+        weight_bytes = weight.numpy().tobytes()
+        bias_bytes = bias.numpy().tobytes()
+        header = json.dumps({
+            "__metadata__": {"format": "pt"},
+            "weight": {"dtype": "F32", "shape": [2, 3],
+                       "data_offsets": [0, len(weight_bytes)]},
+            "bias": {"dtype": "I64", "shape": [3],
+                     "data_offsets": [len(weight_bytes), len(weight_bytes) + len(bias_bytes)]},
+        }).encode()
+
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "model.safetensors")
+            with open(path, "wb") as f:
+                f.write(struct.pack("<Q", len(header)))
+                f.write(header)
+                f.write(weight_bytes)
+                f.write(bias_bytes)
+
+            # Chunks smaller than a tensor so every upload takes several
+            tensors = remote_cuda.load_checkpoint(path, num_threads=2, chunk_bytes=8)
+
+        self.assertEqual(list(tensors.keys()), ["weight", "bias"])
+        self.assertEqual(tensors["weight"].shape, (2, 3))
+        self.assertEqual(tensors["weight"].dtype, torch.float32)
+        self.assertEqual(tensors["bias"].dtype, torch.int64)
+        self.assertEqual(tensors["weight"].device.type, remote_cuda.REMOTE_CUDA.type)
+        self.assertTrue(torch.equal(tensors["weight"].cpu(), weight.view(2, 3)))
+        self.assertTrue(torch.equal(tensors["bias"].cpu(), bias))
+
+    def test_load_checkpoint_rejects_overflow(self):
+        header = b'{"weight": {"dtype": "F32", "shape": [99999999999999999999], "data_offsets": [0, 4]}}'
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "model.safetensors")
+            with open(path, "wb") as f:
+                f.write(struct.pack("<Q", len(header)))
+                f.write(header)
+                f.write(bytes(4))
+            with self.assertRaises(RuntimeError):
+                remote_cuda.load_checkpoint(path)
+
+    def test_strided_transfer(self):
+        base = torch.arange(24, dtype=torch.float32).reshape(4, 6)
+        views = {
+            "transposed": base.t(),
+            "sliced": base[:, 1:5:2],
+            "transposed slice": base[1:3].t(),
+            "broadcast": torch.arange(6, dtype=torch.float32).expand(4, 6),
+        }
+        for name, view in views.items():
+            with self.subTest(name):
+                # Upload packs the host view
+                self.assertTrue(torch.equal(view.to(self.device).cpu(), view))
+
+        # Download of remote views packs on the executor
+        remote = base.to(self.device)
+        self.assertTrue(torch.equal(remote.t().cpu(), base.t()))
+        self.assertTrue(torch.equal(remote[:, 1:5:2].cpu(), base[:, 1:5:2]))
+
+        # Broadcasting copy into an existing remote tensor
+        dst = torch.empty(3, 4, device=self.device)
+        dst.copy_(torch.arange(4, dtype=torch.float32))
+        self.assertTrue(torch.equal(dst.cpu(), torch.arange(4, dtype=torch.float32).expand(3, 4)))
+
+    def test_transfer_casts(self):
+        # Widening ships the narrow dtype and converts on the executor
+        small = torch.arange(-3, 3, dtype=torch.int8)
+        self.assertTrue(torch.equal(small.to(self.device, torch.float32).cpu(), small.float()))
+        # Narrowing converts before the data crosses the link, in both directions
+        wide = torch.linspace(-1, 1, 7, dtype=torch.float64)
+        self.assertTrue(torch.equal(wide.to(self.device, torch.float32).cpu(), wide.float()))
+        remote_wide = wide.to(self.device)
+        self.assertTrue(torch.equal(remote_wide.to("cpu", torch.float32), wide.float()))
+        self.assertTrue(torch.equal(remote_wide.cpu(), wide))
+
+    def test_strided_transfer_ships_only_live_elements(self):
+        base = torch.zeros(1024, 1024)
+        view = base.t()[:16]  # 16 strided rows, 64 KiB of live data in a 4 MiB span
+        remote_cuda.configure_link(rtt_us=1)
+        try:
+            remote_cuda.reset_link_stats()
+            view.to(self.device)
+            sent = remote_cuda.link_stats()["bytes_sent"]
+        finally:
+            remote_cuda.configure_link("loopback")
+        self.assertGreaterEqual(sent, view.nbytes)
+        self.assertLess(sent, view.nbytes * 1.1)
+
+    def test_rng_state(self):
+        # Generator state lives in a (seed, offset) pair mirrored on the client
+        remote_cuda.manual_seed(1234)
+        self.assertEqual(remote_cuda.initial_seed(), 1234)
+        state = remote_cuda.get_rng_state()
+
+        torch.empty(8, device=self.device).normal_()
+        self.assertFalse(torch.equal(state, remote_cuda.get_rng_state()))
+
+        remote_cuda.set_rng_state(state)
+        self.assertTrue(torch.equal(state, remote_cuda.get_rng_state()))
+
+        # torch.manual_seed reaches the remote generators too
+        torch.manual_seed(7)
+        self.assertEqual(remote_cuda.initial_seed(), 7)
+
+        # Negative seeds wrap around as they do on CPU and CUDA
+        torch.manual_seed(-1)
+        self.assertEqual(remote_cuda.initial_seed(), (1 << 64) - 1)
+        remote_cuda.manual_seed((1 << 64) - 1)
+        self.assertEqual(remote_cuda.initial_seed(), (1 << 64) - 1)
+
+        # The same seed replays the same values
+        remote_cuda.manual_seed(11)
+        first = torch.empty(64, device=self.device).normal_().cpu()
+        remote_cuda.manual_seed(11)
+        second = torch.empty(64, device=self.device).normal_().cpu()
+        self.assertTrue(torch.equal(first, second))
+
+        # randint goes through random_.from, which draws on the executor too
+        remote_cuda.manual_seed(3)
+        first = torch.randint(5, 10, (64,), device=self.device).cpu()
+        remote_cuda.manual_seed(3)
+        second = torch.randint(5, 10, (64,), device=self.device).cpu()
+        self.assertTrue(torch.equal(first, second))
+        self.assertTrue(((first >= 5) & (first < 10)).all())
+
+    def test_resize_grows_geometrically(self):
+        # Appending one row at a time should only reallocate O(log n) times
+        cache = torch.empty(4, device=self.device)
+        cache.resize_(5)
+        self.assertEqual(cache.shape, (5,))
+        self.assertGreaterEqual(cache.untyped_storage().nbytes(), 8 * cache.element_size())
+
+        ptr = cache.data_ptr()
+        cache.resize_(8)
+        self.assertEqual(cache.data_ptr(), ptr)
+
+    def test_oversubscription(self):
+        # Past the limit the coldest tensors go to host memory and fault back on use
+        limit = 1 << 20
+        remote_cuda.init(use_memory_pool=False, oversubscribe=True, device_memory_limit=limit)
+        tensors = []
+        try:
+            before = torch.remote_cuda.memory_stats()
+            expected = [torch.arange(64 * 1024, dtype=torch.float32) + i for i in range(8)]
+            tensors = [t.to(self.device) for t in expected]  # 2 MiB in total
+            after_alloc = torch.remote_cuda.memory_stats()
+            self.assertGreater(after_alloc["num_evictions"], before["num_evictions"])
+            self.assertLessEqual(torch.remote_cuda.memory_reserved(), limit)
+
+            # The first tensor is the coldest, so it was evicted and faults back in
+            self.assertTrue(torch.equal(tensors[0].cpu(), expected[0]))
+            self.assertGreater(torch.remote_cuda.memory_stats()["num_faults"], after_alloc["num_faults"])
+
+            # Growing an evicted tensor faults it back in before copying
+            tensors[1].resize_(128 * 1024)
+            self.assertTrue(torch.equal(tensors[1].cpu()[:64 * 1024], expected[1]))
+
+            # Copying between two evicted tensors faults both back in, and
+            # faulting in the destination must not evict the source
+            tensors[3].copy_(tensors[2])
+            self.assertTrue(torch.equal(tensors[3].cpu(), expected[2]))
+        finally:
+            tensors.clear()
+            remote_cuda.init()
+
+    def test_strided_transfer_under_oversubscription(self):
+        # Staging for a strided copy can evict, but never the tensor being copied into
+        remote_cuda.init(use_memory_pool=False, oversubscribe=True, device_memory_limit=1 << 20)
+        tensors = []
+        try:
+            target = torch.zeros(256, 256, device=self.device)  # 256 KiB, the coldest
+            tensors = [torch.ones(64 * 1024, device=self.device) for _ in range(4)]
+            host = torch.randn(256, 256)
+            target.copy_(host.t())
+            self.assertTrue(torch.equal(target.cpu(), host.t()))
+            self.assertTrue(torch.equal(target.t().cpu(), host))
+        finally:
+            tensors.clear()
+            remote_cuda.init()
+
+    def test_link_emulation(self):
+        # Every executor request pays at least the configured RTT
+        remote_cuda.configure_link(rtt_us=2000)
+        try:
+            remote_cuda.reset_link_stats()
+            torch.ones(1024).to(self.device)
+            stats = remote_cuda.link_stats()
+        finally:
+            remote_cuda.configure_link("loopback")
+
+        self.assertGreaterEqual(stats["requests"], 2)  # alloc + upload
+        self.assertGreaterEqual(stats["bytes_sent"], 1024 * 4)
+        self.assertGreaterEqual(stats["delay_s"], 2 * 0.002)
+
+        with self.assertRaises(ValueError):
+            remote_cuda.configure_link("carrier_pigeon")
+
+        # Profiles run from the nearest link to the farthest
+        rtts = [profile.get("rtt_us", 0) for profile in remote_cuda.LINK_PROFILES.values()]
+        self.assertEqual(rtts, sorted(rtts))
+        self.assertGreater(remote_cuda.LINK_PROFILES["cross_region"]["rtt_us"],
+                           remote_cuda.LINK_PROFILES["cross_datacenter"]["rtt_us"])
+
+    def test_memory_stats(self):
+        torch.remote_cuda.reset_peak_memory_stats()
+        before = torch.remote_cuda.memory_allocated()
+        a = torch.empty(1024, device=self.device)
+        self.assertGreaterEqual(torch.remote_cuda.memory_allocated(), before + a.nbytes)
+        self.assertGreaterEqual(torch.remote_cuda.max_memory_allocated(),
+                                torch.remote_cuda.memory_allocated())
+
+        stats = torch.remote_cuda.memory_stats()
+        self.assertIn("allocated_bytes.all.current", stats)
+        self.assertIn("reserved_bytes.all.peak", stats)
+        self.assertGreaterEqual(stats["reserved_bytes.all.current"],
+                                stats["allocated_bytes.all.current"])
+
+        del a
+        self.assertEqual(torch.remote_cuda.memory_allocated(), before)
+
+    def test_memory_snapshot(self):
+        torch.remote_cuda.memory._record_memory_history(max_entries=4)
+        try:
+            for _ in range(3):
+                torch.empty(256, device=self.device)
+            snapshot = torch.remote_cuda.memory._snapshot()
+        finally:
+            torch.remote_cuda.memory._record_memory_history(enabled=None)
+
+        # Three allocs and three frees, each free logged twice: the ring keeps the last 4
+        trace = snapshot["device_traces"][0]
+        self.assertEqual(len(trace), 4)
+        self.assertEqual(trace[-1]["action"], "free_completed")
+        times = [event["time_us"] for event in trace]
+        self.assertEqual(times, sorted(times))
+        alloc = next(event for event in trace if event["action"] == "alloc")
+        self.assertGreaterEqual(alloc["size"], 256 * 4)
+        self.assertTrue(any(frame["name"] == "test_memory_snapshot" for frame in alloc["frames"]))
+
+        self.assertEqual(torch.remote_cuda.memory_snapshot(), snapshot["segments"])